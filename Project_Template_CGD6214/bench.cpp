@@ -0,0 +1,310 @@
+// ===== Solar System — CPU kernel micro-benchmarks =====
+// A small Google-Benchmark-style harness over the GL-free kernels in solar_core.h:
+// mesh generation, the per-body transform pass, the orbit integrator, the orbit
+// camera, ephemeris evaluation and image decode. Body counts sweep 10..1M.
+// Usage: solar_bench [--filter=SUBSTR] [--min-time=SECONDS] [--textures=DIR]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#undef STB_IMAGE_IMPLEMENTATION
+
+#include "solar_core.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// ===================== HARNESS =====================
+namespace bench {
+
+// keeps a value (and everything that produced it) alive without costing more than a store
+template <class T>
+inline void DoNotOptimize(const T& value) {
+#ifdef _MSC_VER
+    static const volatile void* sink; sink = &value; _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+#ifdef __GNUC__
+#define BENCH_UNUSED __attribute__((unused))
+#else
+#define BENCH_UNUSED
+#endif
+
+class State {
+public:
+    struct BENCH_UNUSED Value {};                   // what `auto _` binds to; never read
+    State(int64_t arg, int64_t iterations) : arg_(arg), iterations_(iterations) {}
+    int64_t range(int = 0) const { return arg_; }
+    int64_t iterations() const { return iterations_; }
+    void SetItemsProcessed(int64_t n) { items_ = n; }
+    void SetBytesProcessed(int64_t n) { bytes_ = n; }
+    void SetLabel(const std::string& l) { label_ = l; }
+    void SkipWithError(const char* msg) { error_ = msg; remaining_ = 0; }
+
+    // for (auto _ : state) { ... } runs the body iterations() times between the clock reads
+    struct Iterator {
+        State* s;
+        bool operator!=(const Iterator&) const { return s->remaining_ > 0; }
+        void operator++() { if (--s->remaining_ == 0) s->stop(); }
+        Value operator*() const { return {}; }
+    };
+    Iterator begin() { remaining_ = error_.empty() ? iterations_ : 0; start_ = Clock::now(); if (!remaining_) stop(); return { this }; }
+    Iterator end() { return { this }; }
+
+    double seconds() const { return seconds_; }
+    int64_t items() const { return items_; }
+    int64_t bytes() const { return bytes_; }
+    const std::string& label() const { return label_; }
+    const std::string& error() const { return error_; }
+private:
+    using Clock = std::chrono::steady_clock;
+    void stop() { seconds_ = std::chrono::duration<double>(Clock::now() - start_).count(); }
+    int64_t arg_, iterations_, remaining_ = 0, items_ = 0, bytes_ = 0;
+    double seconds_ = 0.0;
+    Clock::time_point start_;
+    std::string label_, error_;
+};
+
+struct Benchmark {
+    std::string name; void (*fn)(State&); std::vector<int64_t> args; int64_t mult = 8;
+    Benchmark* Arg(int64_t a) { args.push_back(a); return this; }
+    Benchmark* RangeMultiplier(int64_t m) { mult = m; return this; }
+    Benchmark* Range(int64_t lo, int64_t hi) {
+        for (int64_t a = lo; a < hi; a *= mult) args.push_back(a);
+        args.push_back(hi); return this;
+    }
+};
+inline std::vector<Benchmark*>& registry() { static std::vector<Benchmark*> r; return r; }
+inline Benchmark* registerBenchmark(const char* name, void (*fn)(State&)) {
+    Benchmark* b = new Benchmark{ name, fn, {} };
+    registry().push_back(b); return b;
+}
+
+inline std::string humanRate(double perSecond, const char* unit) {
+    const char* prefix[] = { "", "k", "M", "G", "T" };
+    int p = 0;
+    while (perSecond >= 1000.0 && p < 4) { perSecond /= 1000.0; ++p; }
+    char buf[32]; std::snprintf(buf, sizeof(buf), "%.2f%s%s/s", perSecond, prefix[p], unit);
+    return buf;
+}
+inline std::string humanTime(double ns) {
+    char buf[32];
+    if (ns < 1e3) std::snprintf(buf, sizeof(buf), "%.1f ns", ns);
+    else if (ns < 1e6) std::snprintf(buf, sizeof(buf), "%.2f us", ns / 1e3);
+    else if (ns < 1e9) std::snprintf(buf, sizeof(buf), "%.2f ms", ns / 1e6);
+    else std::snprintf(buf, sizeof(buf), "%.2f s", ns / 1e9);
+    return buf;
+}
+
+// grows the iteration count until one run lasts at least minTime, then reports that run
+inline int runAll(const std::string& filter, double minTime) {
+    std::printf("%-36s %14s %12s %16s\n", "Benchmark", "Time", "Iterations", "Throughput");
+    std::printf("%s\n", std::string(82, '-').c_str());
+    for (Benchmark* b : registry()) {
+        std::vector<int64_t> args = b->args.empty() ? std::vector<int64_t>{ 0 } : b->args;
+        for (int64_t a : args) {
+            std::string name = b->name + (b->args.empty() ? "" : "/" + std::to_string(a));
+            if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+            int64_t iters = 1;
+            for (;;) {
+                State st(a, iters);
+                b->fn(st);
+                if (!st.error().empty()) { std::printf("%-36s %s\n", name.c_str(), ("skipped: " + st.error()).c_str()); break; }
+                if (st.seconds() >= minTime || iters >= 1000000000) {
+                    double ns = st.seconds() * 1e9 / iters;
+                    std::string rate = st.bytes() ? humanRate(st.bytes() / st.seconds(), "B")
+                                     : st.items() ? humanRate(st.items() / st.seconds(), " items") : "";
+                    std::printf("%-36s %14s %12lld %16s %s\n", name.c_str(), humanTime(ns).c_str(), (long long)iters,
+                                rate.c_str(), st.label().c_str());
+                    break;
+                }
+                // aim 40% past the target so the next attempt usually lands
+                double guess = st.seconds() > 0.0 ? minTime * 1.4 / st.seconds() * iters : iters * 100.0;
+                iters = std::max(iters + 1, std::min((int64_t)guess, iters * 100));
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCHMARK(fn) static bench::Benchmark* BENCH_CONCAT(bench_reg_, __LINE__) = bench::registerBenchmark(#fn, fn)
+
+// ===================== FIXTURES =====================
+// the fields advanceOrbits / bodyTransforms read from Planet; groups of 8: a planet and 7 moons
+struct BenchBody {
+    float orbitRadius, orbitSpeed, spinSpeed, orbitAngle, spinAngle, eccentricity;
+    int parent, ephem;
+};
+
+static std::vector<BenchBody> makeBodies(size_t n) {
+    std::vector<BenchBody> v(n);
+    uint32_t seed = 1234567u;
+    auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) * (1.0f / 16777216.0f); };
+    for (size_t i = 0; i < n; ++i) {
+        bool moon = i % 8 != 0;
+        v[i] = { moon ? 1.0f + 3.0f * rnd() : 4.0f + 40.0f * rnd(), moon ? 40.0f + 60.0f * rnd() : 5.0f + 40.0f * rnd(),
+                 100.0f * rnd() - 20.0f, 360.0f * rnd(), 360.0f * rnd(), 0.2f * rnd(), moon ? (int)(i & ~(size_t)7) : -1, -1 };
+    }
+    return v;
+}
+static std::string textureDir = "textures";
+
+// ===================== MESH GENERATION =====================
+// stacks; slices = 2 * stacks like every lattice the app builds (48 and 96 hit the constexpr tables)
+static void BM_GenSphere(bench::State& state) {
+    int stacks = (int)state.range(0);
+    std::vector<VtxS> v; std::vector<unsigned int> idx;
+    for (auto _ : state) { genSphere(stacks, stacks * 2, v, idx); bench::DoNotOptimize(v.data()); }
+    state.SetItemsProcessed(state.iterations() * (int64_t)v.size());
+}
+BENCHMARK(BM_GenSphere)->Arg(24)->Arg(32)->Arg(40)->Arg(48)->Arg(96)->Arg(128);
+
+static void BM_GenRing(bench::State& state) {
+    int segments = (int)state.range(0);
+    std::vector<Vtx> v; std::vector<unsigned int> idx;
+    for (auto _ : state) { genRing(segments, 1.8f, 3.2f, v, idx); bench::DoNotOptimize(v.data()); }
+    state.SetItemsProcessed(state.iterations() * (int64_t)v.size());
+}
+BENCHMARK(BM_GenRing)->RangeMultiplier(4)->Range(64, 16384);
+
+static void BM_GenOrbitLine(bench::State& state) {
+    int segments = (int)state.range(0);
+    std::vector<glm::vec3> p; std::vector<unsigned int> idx;
+    for (auto _ : state) { genOrbitLine(segments, 12.0f, p, idx); bench::DoNotOptimize(p.data()); }
+    state.SetItemsProcessed(state.iterations() * segments);
+}
+BENCHMARK(BM_GenOrbitLine)->RangeMultiplier(4)->Range(64, 65536);
+
+// ===================== PER-BODY KERNELS =====================
+// the per-frame hierarchy pass: parent frame -> orbit position -> spin, for every body
+static void BM_TransformChain(bench::State& state) {
+    std::vector<BenchBody> bodies = makeBodies((size_t)state.range(0));
+    std::vector<glm::mat4> frame, world;
+    for (auto _ : state) {
+        bodyTransforms(bodies, std::vector<glm::vec3>(), frame, world);
+        bench::DoNotOptimize(world.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)bodies.size());
+}
+BENCHMARK(BM_TransformChain)->RangeMultiplier(10)->Range(10, 1000000);
+
+// the whole orbit step at 1x: budget bucketing, the batched RK4 and the scatter back
+static void BM_AdvanceOrbits(bench::State& state) {
+    std::vector<BenchBody> bodies = makeBodies((size_t)state.range(0));
+    for (auto _ : state) {
+        int steps = advanceOrbits(bodies, 1.0f / 60.0f);
+        bench::DoNotOptimize(steps);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)bodies.size());
+}
+BENCHMARK(BM_AdvanceOrbits)->RangeMultiplier(10)->Range(10, 1000000);
+
+// the adaptive orbit kernel for one budget bucket: eccentric bodies at 100x time compression
+static void BM_IntegrateAnomaly(bench::State& state) {
+    std::vector<BenchBody> bodies = makeBodies((size_t)state.range(0));
+    std::vector<float> theta, c, e;
+    for (const BenchBody& b : bodies) {
+        theta.push_back(b.orbitAngle); c.push_back(anomalyRateScale(b.orbitSpeed, b.eccentricity)); e.push_back(b.eccentricity);
+    }
+    const float adv = 100.0f / 60.0f;
+    int steps = 1 << substepBudgetLog2(*std::max_element(c.begin(), c.end()), 0.2f, adv);
+    for (auto _ : state) {
+        integrateAnomaly(theta.data(), c.data(), e.data(), (int)theta.size(), steps, adv / steps);
+        bench::DoNotOptimize(theta.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)bodies.size() * steps);
+    state.SetLabel(std::to_string(steps) + " substeps");
+}
+BENCHMARK(BM_IntegrateAnomaly)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_OrbitCamPos(bench::State& state) {
+    int64_t n = state.range(0);
+    for (auto _ : state) {
+        glm::vec3 acc(0.0f);
+        for (int64_t i = 0; i < n; ++i) acc += orbitCamPos(i * 0.001f, 0.26f, 45.0f);
+        bench::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_OrbitCamPos)->RangeMultiplier(10)->Range(10, 1000000);
+
+// ===================== EPHEMERIS =====================
+// direct Kepler solve per body vs. one Chebyshev segment evaluated across all bodies at once
+static void BM_KeplerPosition(bench::State& state) {
+    int64_t n = state.range(0);
+    std::vector<double> out((size_t)n * 3);
+    double jd = kJ2000;
+    for (auto _ : state) {
+        for (int64_t i = 0; i < n; ++i) keplerPosition(kPlanetElements[i % kPlanetCount], jd, &out[(size_t)i * 3]);
+        jd += 0.25;
+        bench::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_KeplerPosition)->RangeMultiplier(8)->Range(8, 32768);
+
+static void BM_ChebyshevEval(bench::State& state) {
+    const int coeffs = 12;
+    int n = (int)state.range(0), stride = (n + 3) & ~3;
+    std::vector<double> block((size_t)3 * coeffs * stride);
+    for (int b = 0; b < n; ++b)
+        for (int c = 0; c < 3; ++c) {
+            const KeplerElements& k = kPlanetElements[b % kPlanetCount];
+            double tmp[coeffs];
+            chebFit([&](double jd) { double p[3]; keplerPosition(k, jd, p); return p[c]; }, kJ2000, kJ2000 + 16.0, coeffs, tmp);
+            for (int j = 0; j < coeffs; ++j) block[((size_t)c * coeffs + j) * stride + b] = tmp[j];
+        }
+    std::vector<double> x(stride), y(stride), z(stride);
+    double tau = -1.0;
+    for (auto _ : state) {
+        chebEvalSegment(block.data(), coeffs, stride, tau, x.data(), y.data(), z.data());
+        tau = tau < 1.0 ? tau + 1.0 / 64 : -1.0;
+        bench::DoNotOptimize(x.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ChebyshevEval)->RangeMultiplier(8)->Range(8, 32768);
+
+// ===================== IMAGE DECODE =====================
+static const char* kBenchTextures[] = { "saturnRing.png", "uranus.jpg", "earth_day.jpg", "moon.jpg" };
+
+static void BM_DecodeImage(bench::State& state) {
+    std::string path = textureDir + "/" + kBenchTextures[state.range(0)];
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        ImageData img = decodeImageFile(path.c_str());
+        if (!img.pixels) { state.SkipWithError(("cannot decode " + path).c_str()); break; }
+        bytes += (int64_t)img.w * img.h * img.ch;
+        stbi_image_free(img.pixels);
+    }
+    state.SetBytesProcessed(bytes);
+    state.SetLabel(kBenchTextures[state.range(0)]);
+}
+BENCHMARK(BM_DecodeImage)->Arg(0)->Arg(1)->Arg(2)->Arg(3);
+
+// ===================== MAIN =====================
+int main(int argc, char** argv) {
+    std::string filter; double minTime = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--filter=") == 0) filter = arg.substr(9);
+        else if (arg.compare(0, 11, "--min-time=") == 0) minTime = std::atof(arg.c_str() + 11);
+        else if (arg.compare(0, 11, "--textures=") == 0) textureDir = arg.substr(11);
+        else { std::fprintf(stderr, "Unknown option: %s\n", arg.c_str()); return 1; }
+    }
+    meshStatsOutput() = false;
+    return bench::runAll(filter, minTime);
+}
@@ -1,14 +1,24 @@
-﻿// ===== Solar System — OpenGL 3.3 (single file) =====
+﻿// ===== Solar System — OpenGL 3.3 =====
 // Features: Orbit/Free/Focus cameras, Phong lighting, textures, rings, starfield,
 // orbit lines, pause & time control, HUD 2D circle, Europa (Jupiter moon).
+// Bodies, moons and rings are loaded from scenes/solar.scene (--scene PATH);
+// --ephemeris [YYYY-MM-DD] places the planets from Chebyshev ephemeris segments.
+// The starfield is drawn from a star catalog (--star-catalog CSV, else a generated one).
+// The scene resolution adapts to the frame budget (--target-fps N, or --render-scale S fixed).
 // Controls:
 //   1 Orbit cam, 2 Free cam (RMB look + WASD/QE), 3 Focus cam (N/P cycle)
-//   Mouse wheel: zoom/FOV | H: toggle orbit lines | B: toggle stars
+//   Mouse wheel: zoom/FOV | H: toggle orbit lines | B: stars catalog / image / off
 //   [ / ] time speed | Space pause/resume | F11 or Alt+Enter fullscreen
-//   - / = FOV | Z/X focus-cam distance | ESC quit
+//   - / = FOV | Z/X focus-cam distance | F9 record video | ESC quit
+//   Left/Right seek time (Shift x10) | Home rewind to start
+//   O opaque pass: scene order / front-to-back / depth prepass (--opaque MODE)
+//   G bloom on/off (--no-bloom); the scene is lit in HDR and tonemapped
+//   V vsync on/off (--no-vsync); --fps-cap N limits the rate, --paused-fps N while paused
+// A static scene is not redrawn: the loop waits for events until something changes (--no-idle).
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#undef STB_IMAGE_IMPLEMENTATION   // solar_core.h includes it again for the declarations
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -16,12 +26,31 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "solar_core.h"
+
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <iostream>
 #include <vector>
 #include <cmath>
 #include <iomanip>   // << std::setprecision
 #include <cstdio>    // std::snprintf
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
 
 // ===================== FORCE CONSOLE (Windows) =====================
 #ifdef _WIN32
@@ -29,6 +58,7 @@
 #define NOMINMAX
 #endif
 #include <windows.h>
+#include <direct.h>    // _mkdir
 static void open_console() {
     if (!GetConsoleWindow()) {
         AllocConsole();
@@ -43,6 +73,10 @@ static void open_console() {
 #pragma comment(linker, "/SUBSYSTEM:CONSOLE")
 #endif
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 static void open_console() {}
 #endif
 
@@ -50,17 +84,25 @@ static void print_controls() {
     std::cout <<
         "Controls:\n"
         "  1 Orbit cam, 2 Free cam (RMB look + WASD/QE), 3 Focus cam (N/P cycle)\n"
-        "  Mouse wheel: zoom/FOV   |  H: toggle orbit lines   |  B: toggle stars\n"
+        "  Mouse wheel: zoom/FOV   |  H: toggle orbit lines   |  B: stars catalog / image / off\n"
         "  [ / ] time speed   |  Space pause/resume   |  F11 or Alt+Enter fullscreen\n"
-        "  - / = FOV          |  Z/X focus distance   |  ESC quit\n\n";
+        "  - / = FOV          |  Z/X focus distance   |  F9 record video (captures/*.y4m)\n"
+        "  Left/Right seek simulated time (Shift x10)  |  Home back to t=0\n"
+        "  O opaque pass: scene order / front-to-back / depth prepass  |  G bloom on/off\n"
+        "  V vsync on/off\n"
+        "  ESC quit\n\n";
 }
 
 // ===================== GLOBAL STATE =====================
 enum CamMode { ORBIT = 0, FREE = 1, FOCUS = 2 };
 CamMode camMode = ORBIT;
 
-bool showOrbits = true, showStars = true, paused = false;
+enum StarMode { STARS_CATALOG = 0, STARS_IMAGE = 1, STARS_OFF = 2 };
+int starMode = STARS_CATALOG;
+
+bool showOrbits = true, paused = false;
 float timeScale = 1.0f;
+double seekBy = 0.0; bool seekHome = false;   // Left/Right/Home, applied by the main loop
 float fovDeg = 45.0f;
 int winW = 1280, winH = 720;
 
@@ -73,185 +115,2789 @@ float camDist = 45.0f;
 glm::vec3 freePos(0, 10, 60);
 float freeYaw = 0.0f, freePitch = 0.0f;
 
-// mouse (shared)
-bool rmbDown = false;
-double lastX = 0.0, lastY = 0.0;
+// mouse (shared)
+bool rmbDown = false;
+double lastX = 0.0, lastY = 0.0;
+
+// focus cam
+int focusIndex = 0;
+int focusCount = 1;                  // bodies N/P cycles through, set from the scene
+float focusDist = 12.0f;
+
+// fullscreen tracking
+bool fullscreen = false;
+int savedX = 100, savedY = 100, savedW = 1280, savedH = 720;
+
+// frame capture: F9 flips this, the main loop starts/stops the recording
+bool captureToggle = false;
+
+// OpaqueMode: how the bodies are submitted (O cycles, --opaque sets)
+int opaqueMode = 0;
+
+// bloom pyramid on the HDR resolve (G toggles, --no-bloom starts it off)
+bool bloomOn = true;
+
+// frame pacing: V toggles vsync, the main loop applies it; caps from --fps-cap / --paused-fps
+int swapInterval = 1;
+double fpsCap = 0.0, pausedFps = 15.0;
+
+// render on demand (--no-idle turns it off); the refresh callback asks for a redraw
+bool renderOnDemand = true, refreshRequested = true;
+
+// ===================== SHADERS =====================
+// fsSrc is specialised per material through #defines, see SHADER VARIANTS
+static const char* vsSrc = R"(#version 330 core
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec3 aNormal;
+layout (location=2) in vec2 aUV;
+uniform mat4 model, view, projection;
+out vec3 FragPos; out vec3 Normal; out vec2 UV;
+invariant gl_Position;                    // the depth prepass must land on the same depths as the lit pass
+void main(){
+  FragPos = vec3(model * vec4(aPos,1.0));
+  Normal  = mat3(transpose(inverse(model))) * aNormal;
+  UV = aUV;
+  gl_Position = projection * view * vec4(FragPos,1.0);
+})";
+
+static const char* fsSrc = R"(#version 330 core
+out vec4 FragColor;
+in vec3 FragPos; in vec3 Normal; in vec2 UV;
+uniform vec3 lightPos, lightColor, viewPos;
+#if defined(VIRTUAL_TEXTURE)
+uniform sampler2D vtPool;
+uniform usampler2D vtTable;
+#elif defined(TEXTURED)
+uniform sampler2D albedo;
+#else
+uniform vec3 baseColor;
+#endif
+#ifdef EMISSIVE
+uniform vec3 emissive;
+#endif
+#ifndef UNLIT
+uniform float shininess;
+uniform float ks;
+#endif
+#ifdef CLUSTERED_LIGHTS
+uniform mat4 view;
+uniform samplerBuffer lightData;          // two texels per light: position, range | colour
+uniform usamplerBuffer clusterGrid, lightIndices;
+uniform vec4 clusterParams;               // tile size (px), depth slice scale and bias
+// the lights binned into this fragment's cluster; range 0 means unattenuated, like the primary
+vec3 clusteredLight(vec3 N, vec3 V){
+  float vz = -(view * vec4(FragPos, 1.0)).z;
+  ivec3 c = ivec3(ivec2(gl_FragCoord.xy / clusterParams.xy), int(floor(log(vz) * clusterParams.z + clusterParams.w)));
+  c = clamp(c, ivec3(0), ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+  uvec2 list = texelFetch(clusterGrid, (c.z * CLUSTER_Y + c.y) * CLUSTER_X + c.x).xy;
+  vec3 sum = vec3(0.0);
+  for (uint k = 0u; k < list.y; ++k) {
+    int li = int(texelFetch(lightIndices, int(list.x + k)).r);
+    vec4 pr = texelFetch(lightData, 2 * li);
+    vec3 col = texelFetch(lightData, 2 * li + 1).rgb;
+    vec3 Lv = pr.xyz - FragPos;
+    float d2 = max(dot(Lv, Lv), 1e-6);
+    float att = 1.0;
+    if (pr.w > 0.0) {                     // inverse square, windowed smoothly to zero at the range
+      float f = clamp(1.0 - (d2 * d2) / (pr.w * pr.w * pr.w * pr.w), 0.0, 1.0);
+      att = f * f / (1.0 + d2);
+    }
+    vec3 L = Lv * inversesqrt(d2);
+    vec3 H = normalize(L + V);
+    sum += (max(dot(N, L), 0.0) + ks * pow(max(dot(N, H), 0.0), max(shininess, 1.0))) * att * col;
+  }
+  return sum;
+}
+#endif
+#ifdef ECLIPSE
+uniform float lightRadius;
+uniform vec4 occluders[4];                // centre, radius: this draw's candidates from findEclipses
+uniform int occluderCount;
+// fraction of the Sun's disc visible from p: each occluder hides the lens where its disc overlaps
+float sunVisibility(vec3 p){
+  vec3 toS = lightPos - p; float dS = length(toS);
+  float a = asin(clamp(lightRadius / dS, 0.0, 1.0));
+  float vis = 1.0;
+  for (int i = 0; i < occluderCount; ++i) {
+    vec3 toO = occluders[i].xyz - p; float dO = length(toO);
+    float r = occluders[i].w;
+    if (dO >= dS || dO <= r) continue;    // beyond the light, or p is inside the occluder
+    float b = asin(r / dO);
+    float c = atan(length(cross(toS, toO)), dot(toS, toO));
+    if (c >= a + b) continue;
+    float a2 = a * a, b2 = b * b, hidden;
+    if (c <= abs(a - b)) hidden = min(a2, b2);
+    else {
+      float ka = acos(clamp((c * c + a2 - b2) / (2.0 * c * a), -1.0, 1.0));
+      float kb = acos(clamp((c * c + b2 - a2) / (2.0 * c * b), -1.0, 1.0));
+      hidden = a2 * ka + b2 * kb - 0.5 * sqrt(max(0.0, (-c + a + b) * (c + a - b) * (c - a + b) * (c + a + b)));
+    }
+    vis *= 1.0 - clamp(hidden / (3.14159265 * a2), 0.0, 1.0);
+  }
+  return vis;
+}
+#endif
+#ifdef VIRTUAL_TEXTURE
+vec3 sampleVT(vec2 uv){
+  int l = vtLevel(uv);
+  ivec2 t = vtTileOf(uv, l);
+  int idx = vtMipBase[l] + t.y * vtTilesX[l] + t.x;
+  uvec4 e = texelFetch(vtTable, ivec2(idx % VT_TABLE_W, idx / VT_TABLE_W), 0);
+  int m = int(e.z);                       // mip actually mapped: l or its nearest resident ancestor
+  vec2 local = clamp(uv, 0.0, 1.0) * vtMipSize[m] - vec2(vtTileOf(uv, m)) * VT_TILE;
+  vec2 phys = (vec2(e.xy) * VT_PAGE + VT_BORDER + local) / (VT_PAGE * VT_POOL);
+  return textureLod(vtPool, phys, 0.0).rgb;
+}
+#endif
+void main(){
+#if defined(VIRTUAL_TEXTURE)
+  vec4 color = vec4(sampleVT(UV), 1.0);
+#elif defined(TEXTURED)
+  vec4 color = texture(albedo, UV);
+#else
+  vec4 color = vec4(baseColor, 1.0);
+#endif
+#ifdef RING_ALPHA
+  if (color.a < 0.01) discard;
+#else
+  color.a = 1.0;
+#endif
+  vec3 light = 0.05 * lightColor;         // ambient
+#ifndef UNLIT
+  vec3 N = normalize(Normal);
+  vec3 L = normalize(lightPos - FragPos);
+  vec3 V = normalize(viewPos - FragPos);
+  vec3 H = normalize(L + V);
+  float diff = max(dot(N,L),0.0);
+  float spec = pow(max(dot(N,H),0.0), max(shininess, 1.0));
+#ifdef ECLIPSE
+  float sun = sunVisibility(FragPos);
+#else
+  float sun = 1.0;
+#endif
+  light += sun * (diff + ks * spec) * lightColor;
+#ifdef CLUSTERED_LIGHTS
+  light += clusteredLight(N, V);
+#endif
+#endif
+#ifdef EMISSIVE
+  light += emissive;
+#endif
+  FragColor = vec4(light * color.rgb, color.a);
+})";
+
+
+static const char* vsLine = R"(#version 330 core
+layout (location=0) in vec3 aPos;
+uniform mat4 mvp;
+void main(){ gl_Position = mvp * vec4(aPos,1.0); })";
+
+static const char* fsLine = R"(#version 330 core
+out vec4 FragColor;
+uniform vec3 color;
+void main(){ FragColor = vec4(color,1.0); })";
+
+// sky: one triangle covering the screen at depth 1; the direction comes from the rotation-only inverse view-projection
+static const char* vsSky = R"(#version 330 core
+uniform mat4 invViewProj;
+out vec3 Dir;
+void main(){
+  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+  vec4 d = invViewProj * vec4(p, 1.0, 1.0);
+  Dir = d.xyz / d.w;
+  gl_Position = vec4(p, 1.0, 1.0);
+})";
+
+static const char* fsSky = R"(#version 330 core
+out vec4 FragColor;
+in vec3 Dir;
+uniform samplerCube sky;
+void main(){ FragColor = vec4(texture(sky, Dir).rgb, 1.0); })";
+
+// catalog stars: directions at infinity, sized and dimmed by how far above the limiting magnitude they are
+static const char* vsStars = R"(#version 330 core
+layout (location=0) in vec3 aDir;
+layout (location=1) in vec2 aCode;        // StarRecord magnitude and B-V codes
+uniform mat4 viewProj;                    // rotation-only view
+uniform float magMin, limitMag, pointScale;
+out vec3 StarColor;
+vec3 bvColor(float bv){
+  vec3 c = mix(vec3(0.62, 0.72, 1.0), vec3(1.0), smoothstep(-0.3, 0.4, bv));
+  c = mix(c, vec3(1.0, 0.86, 0.66), smoothstep(0.4, 1.0, bv));
+  return mix(c, vec3(1.0, 0.62, 0.38), smoothstep(1.0, 1.8, bv));
+}
+void main(){
+  gl_Position = (viewProj * vec4(aDir, 0.0)).xyww;
+  float above = limitMag - (magMin + aCode.x / 16.0);
+  gl_PointSize = (1.5 + 0.5 * above) * pointScale;
+  StarColor = bvColor(aCode.y / 64.0 - 0.5) * clamp(0.2 + 0.15 * above, 0.0, 1.0);
+})";
+
+static const char* fsStars = R"(#version 330 core
+out vec4 FragColor;
+in vec3 StarColor;
+void main(){
+  vec2 q = gl_PointCoord * 2.0 - 1.0;
+  float r2 = dot(q, q);
+  if (r2 > 1.0) discard;
+  FragColor = vec4(StarColor, exp(-3.0 * r2));
+})";
+
+// depth prepass: vsSrc positions, no colour
+static const char* fsDepth = R"(#version 330 core
+void main(){})";
+
+// post passes: one triangle covering the target, UV 0..1 across it
+static const char* vsPost = R"(#version 330 core
+out vec2 UV;
+void main(){
+  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  UV = p;
+  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+})";
+
+// bloom down: four bilinear taps make a 4x4 box over the level above; the first level also
+// soft-thresholds (threshold.x, knee threshold.y) so only light above it blooms
+static const char* fsBloomDown = R"(#version 330 core
+out vec4 FragColor;
+in vec2 UV;
+uniform sampler2D src;
+uniform vec2 texel;                       // 1 / source size
+uniform vec2 threshold;
+void main(){
+  vec3 c = 0.25 * (texture(src, UV + texel * vec2(-1.0, -1.0)).rgb + texture(src, UV + texel * vec2(1.0, -1.0)).rgb
+                 + texture(src, UV + texel * vec2(-1.0,  1.0)).rgb + texture(src, UV + texel * vec2(1.0,  1.0)).rgb);
+  float bright = max(c.r, max(c.g, c.b));
+  float soft = clamp(bright - threshold.x + threshold.y, 0.0, 2.0 * threshold.y);
+  soft = soft * soft / (4.0 * threshold.y + 1e-4);
+  c *= max(soft, bright - threshold.x) / max(bright, 1e-4);
+  FragColor = vec4(c, 1.0);
+})";
+
+// bloom up: 3x3 tent over the smaller level, added onto the level above it
+static const char* fsBloomUp = R"(#version 330 core
+out vec4 FragColor;
+in vec2 UV;
+uniform sampler2D src;
+uniform vec2 texel;
+void main(){
+  vec3 c = 4.0 * texture(src, UV).rgb;
+  c += 2.0 * (texture(src, UV + vec2(texel.x, 0.0)).rgb + texture(src, UV - vec2(texel.x, 0.0)).rgb
+            + texture(src, UV + vec2(0.0, texel.y)).rgb + texture(src, UV - vec2(0.0, texel.y)).rgb);
+  c += texture(src, UV + texel).rgb + texture(src, UV - texel).rgb
+     + texture(src, UV + vec2(texel.x, -texel.y)).rgb + texture(src, UV + vec2(-texel.x, texel.y)).rgb;
+  FragColor = vec4(c / 16.0, 1.0);
+})";
+
+// resolve: HDR scene + bloom, exposure, then the ACES filmic fit down to display range
+static const char* fsTonemap = R"(#version 330 core
+out vec4 FragColor;
+in vec2 UV;
+uniform sampler2D hdr, bloom;
+uniform float exposure, bloomStrength;
+void main(){
+  vec3 c = (texture(hdr, UV).rgb + bloomStrength * texture(bloom, UV).rgb) * exposure;
+  c = clamp(c * (2.51 * c + 0.03) / (c * (2.43 * c + 0.59) + 0.14), 0.0, 1.0);
+  FragColor = vec4(c, 1.0);
+})";
+
+// ===================== STARTUP TIMELINE =====================
+static const std::chrono::steady_clock::time_point kProcessStart = std::chrono::steady_clock::now();
+static double startupMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - kProcessStart).count();
+}
+// small stable id per thread for the report; main() claims 0 before starting the pool
+static int threadSlot() {
+    static std::atomic<int> next{ 0 };
+    thread_local int slot = next++;
+    return slot;
+}
+struct TimelineEvent { std::string name; double startMs, endMs; int thread; };
+static std::mutex timelineMutex;
+static std::vector<TimelineEvent> timeline;
+
+struct TimelineScope {
+    std::string name; double t0;
+    explicit TimelineScope(std::string n) : name(std::move(n)), t0(startupMs()) {}
+    ~TimelineScope() {
+        double t1 = startupMs();
+        std::lock_guard<std::mutex> lk(timelineMutex);
+        timeline.push_back({ name, t0, t1, threadSlot() });
+    }
+};
+static void printStartupTimeline() {
+    std::lock_guard<std::mutex> lk(timelineMutex);
+    std::sort(timeline.begin(), timeline.end(), [](const TimelineEvent& a, const TimelineEvent& b) { return a.startMs < b.startMs; });
+    std::printf("Startup timeline (ms since launch, T0 = main/GL thread):\n");
+    for (const TimelineEvent& e : timeline)
+        std::printf("  T%-2d %8.1f -> %8.1f  (%6.1f)  %s\n", e.thread, e.startMs, e.endMs, e.endMs - e.startMs, e.name.c_str());
+}
+
+// ===================== TASK POOL =====================
+// fixed worker pool for work that needs no GL context (mesh preparation, image decode)
+class TaskPool {
+public:
+    explicit TaskPool(unsigned workers) {
+        for (unsigned i = 0; i < workers; ++i) threads.emplace_back([this] { run(); });
+    }
+    ~TaskPool() {
+        { std::lock_guard<std::mutex> lk(m); stopping = true; }
+        cv.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+    template <class F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        std::future<decltype(f())> fut = task->get_future();
+        { std::lock_guard<std::mutex> lk(m); jobs.emplace_back([task] { (*task)(); }); }
+        cv.notify_one();
+        return fut;
+    }
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front()); jobs.pop_front();
+            }
+            job();
+        }
+    }
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex m; std::condition_variable cv;
+    bool stopping = false;
+};
+
+// ===================== GPU MEMORY =====================
+// Every glTexImage2D / glRenderbufferStorage / glBufferData goes through these wrappers so the readout can show what the
+// GL objects cost. Sizes are what we request (driver padding aside); a texture's mip chain is
+// counted once glGenerateMipmap has run on it.
+struct GpuTexRecord { int w = 0, h = 0, bpp = 0, faces = 1; bool mips = false; };
+static std::unordered_map<GLuint, GpuTexRecord> gpuTextures;
+static std::unordered_map<GLuint, size_t> gpuBuffers;
+static std::unordered_map<GLuint, GpuTexRecord> gpuRenderbuffers;   // counted with the textures
+static size_t gpuTextureBytes = 0, gpuBufferBytes = 0;
+static size_t gpuBudgetBytes = (size_t)128 << 20;   // --gpu-budget-mb
+
+static size_t texRecordBytes(const GpuTexRecord& r) {
+    size_t total = 0; int w = r.w, h = r.h;
+    for (;;) {
+        total += (size_t)w * h * r.bpp * r.faces;
+        if (!r.mips || (w <= 1 && h <= 1)) return total;
+        w = std::max(1, w >> 1); h = std::max(1, h >> 1);
+    }
+}
+static int texelBytes(GLint internalFormat) {
+    switch (internalFormat) {
+    case GL_RED: case GL_R8: return 1;
+    case GL_RGBA16UI: case GL_RGBA16F: return 8;
+    default: return 4;                              // RGBA8 / RGBA8UI, R11F_G11F_B10F, and RGB8 / DEPTH24 which drivers pad to 4
+    }
+}
+static size_t gpuUsedBytes() { return gpuTextureBytes + gpuBufferBytes; }
+static double toMB(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+static void setTexRecord(GLuint t, const GpuTexRecord& r) {
+    GpuTexRecord& cur = gpuTextures[t];
+    gpuTextureBytes -= texRecordBytes(cur);
+    cur = r; gpuTextureBytes += texRecordBytes(cur);
+}
+static GLuint boundTexture2D() { GLint t = 0; glGetIntegerv(GL_TEXTURE_BINDING_2D, &t); return (GLuint)t; }
+// GL_TEXTURE_2D on the bound texture; level 0 defines the record, other levels come from mipmapping
+static void gpuTexImage2D(GLint level, GLint internalFormat, GLsizei w, GLsizei h, GLenum fmt, GLenum type, const void* data) {
+    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, fmt, type, data);
+    if (level != 0) return;
+    GpuTexRecord r; r.w = w; r.h = h; r.bpp = texelBytes(internalFormat);
+    setTexRecord(boundTexture2D(), r);
+}
+static void gpuGenerateMipmap() {
+    glGenerateMipmap(GL_TEXTURE_2D);
+    GLuint t = boundTexture2D();
+    GpuTexRecord r = gpuTextures[t]; r.mips = true;
+    setTexRecord(t, r);
+}
+// on the bound renderbuffer
+static void gpuRenderbufferStorage(GLenum internalFormat, GLsizei w, GLsizei h) {
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, w, h);
+    GLint rb = 0; glGetIntegerv(GL_RENDERBUFFER_BINDING, &rb);
+    GpuTexRecord& cur = gpuRenderbuffers[(GLuint)rb];
+    gpuTextureBytes -= texRecordBytes(cur);
+    cur = GpuTexRecord(); cur.w = w; cur.h = h; cur.bpp = texelBytes(internalFormat);
+    gpuTextureBytes += texRecordBytes(cur);
+}
+static void gpuBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    glBufferData(target, size, data, usage);
+    GLenum binding = target == GL_ELEMENT_ARRAY_BUFFER ? GL_ELEMENT_ARRAY_BUFFER_BINDING
+                   : target == GL_PIXEL_PACK_BUFFER ? GL_PIXEL_PACK_BUFFER_BINDING : GL_ARRAY_BUFFER_BINDING;
+    GLint b = 0; glGetIntegerv(binding, &b);
+    size_t& cur = gpuBuffers[(GLuint)b];
+    gpuBufferBytes = gpuBufferBytes - cur + (size_t)size; cur = (size_t)size;
+}
+
+// ===================== GL HELPERS =====================
+static GLuint makeShader(GLenum t, const char* s) {
+    GLuint sh = glCreateShader(t); glShaderSource(sh, 1, &s, nullptr); glCompileShader(sh);
+    GLint ok; glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+    if (!ok) { char log[1024]; glGetShaderInfoLog(sh, 1024, nullptr, log); std::cerr << "Shader: " << log << "\n"; }
+    return sh;
+}
+// splices shared GLSL in right after the #version line
+static std::string withGlsl(const char* src, const char* snippet) {
+    std::string s = src;
+    size_t eol = s.find('\n');
+    return s.insert(eol == std::string::npos ? s.size() : eol + 1, snippet);
+}
+static GLuint makeProgram(const char* vsrc, const char* fsrc) {
+    GLuint p = glCreateProgram(); GLuint v = makeShader(GL_VERTEX_SHADER, vsrc), f = makeShader(GL_FRAGMENT_SHADER, fsrc);
+    glAttachShader(p, v); glAttachShader(p, f); glLinkProgram(p);
+    GLint ok; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) { char log[1024]; glGetProgramInfoLog(p, 1024, nullptr, log); std::cerr << "Link: " << log << "\n"; }
+    glDeleteShader(v); glDeleteShader(f); return p;
+}
+static ImageData decodeImage(const char* path, bool flipY = true) {
+    TimelineScope ts(std::string("decode ") + path);
+    ImageData img = decodeImageFile(path, flipY);
+    if (!img.pixels) std::cerr << "Texture failed: " << path << " (" << stbi_failure_reason() << ")\n";
+    return img;
+}
+// 2x2 box filter, edges clamped (odd sizes repeat the last row/column)
+static void halveImage(const unsigned char* src, int w, int h, int ch, std::vector<unsigned char>& out) {
+    int nw = std::max(1, w >> 1), nh = std::max(1, h >> 1);
+    out.resize((size_t)nw * nh * ch);
+    for (int y = 0; y < nh; ++y)
+        for (int x = 0; x < nw; ++x)
+            for (int c = 0; c < ch; ++c) {
+                int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+                int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+                int sum = src[((size_t)y0 * w + x0) * ch + c] + src[((size_t)y0 * w + x1) * ch + c]
+                        + src[((size_t)y1 * w + x0) * ch + c] + src[((size_t)y1 * w + x1) * ch + c];
+                out[((size_t)y * nw + x) * ch + c] = (unsigned char)((sum + 2) / 4);
+            }
+}
+static GLenum imageFormat(int ch) { return ch == 1 ? GL_RED : ch == 3 ? GL_RGB : GL_RGBA; }
+static GLuint uploadTexture2D(ImageData img) {
+    if (!img.pixels) return 0;
+    GLenum fmt = imageFormat(img.ch);
+    GLuint t; glGenTextures(1, &t); glBindTexture(GL_TEXTURE_2D, t);
+    gpuTexImage2D(0, fmt, img.w, img.h, fmt, GL_UNSIGNED_BYTE, img.pixels);
+    gpuGenerateMipmap();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    stbi_image_free(img.pixels); return t;
+}
+
+// ===================== FILE MAPPING =====================
+// read-only memory map: loaders hand the mapped bytes straight to GL, no staging copy
+struct MappedFile {
+    const unsigned char* data = nullptr; size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+static void unmapFile(MappedFile& f) {
+#ifdef _WIN32
+    if (f.data) UnmapViewOfFile(f.data);
+    if (f.mapping) CloseHandle(f.mapping);
+    if (f.file != INVALID_HANDLE_VALUE) CloseHandle(f.file);
+    f.file = INVALID_HANDLE_VALUE; f.mapping = nullptr;
+#else
+    if (f.data) munmap((void*)f.data, f.size);
+    if (f.fd >= 0) close(f.fd);
+    f.fd = -1;
+#endif
+    f.data = nullptr; f.size = 0;
+}
+static bool mapFile(const char* path, MappedFile& f) {
+#ifdef _WIN32
+    f.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz;
+    if (GetFileSizeEx(f.file, &sz)) f.size = (size_t)sz.QuadPart;
+    if (f.size) f.mapping = CreateFileMappingA(f.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (f.mapping) f.data = (const unsigned char*)MapViewOfFile(f.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    f.fd = open(path, O_RDONLY);
+    if (f.fd < 0) return false;
+    struct stat st;
+    if (fstat(f.fd, &st) == 0) f.size = (size_t)st.st_size;
+    if (f.size) {
+        void* p = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, f.fd, 0);
+        if (p != MAP_FAILED) f.data = (const unsigned char*)p;
+    }
+#endif
+    if (!f.data) { unmapFile(f); return false; }
+    return true;
+}
+// modification time and size: enough to notice an edited source next to its compiled form
+static bool fileStamp(const char* path, int64_t& time, int64_t& size) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA a;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &a)) return false;
+    time = ((int64_t)a.ftLastWriteTime.dwHighDateTime << 32) | a.ftLastWriteTime.dwLowDateTime;
+    size = ((int64_t)a.nFileSizeHigh << 32) | a.nFileSizeLow;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    time = (int64_t)st.st_mtime; size = (int64_t)st.st_size;
+#endif
+    return true;
+}
+static void makeDir(const char* path) {
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+static uint64_t fnv1a(const void* data, size_t n, uint64_t h = 1469598103934665603ull) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+// ===================== MESHES =====================
+// scale: spheres are built as unit meshes and scaled to their radius by the model matrix
+struct Mesh { GLuint VAO = 0, VBO = 0, EBO = 0; int indexCount = 0; GLenum indexType = GL_UNSIGNED_INT; float scale = 1.0f; };
+
+enum VertexFormat : uint32_t { VF_SPHERE_S16 = 1, VF_FULL = 2, VF_POS = 3 };
+static size_t vertexStride(uint32_t fmt) {
+    return fmt == VF_SPHERE_S16 ? sizeof(VtxS) : fmt == VF_FULL ? sizeof(Vtx) : sizeof(glm::vec3);
+}
+static void setVertexLayout(uint32_t fmt) {
+    if (fmt == VF_SPHERE_S16) {
+        // the normal attribute aliases the position stream: on a unit sphere they are the same vector
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(VtxS), (void*)0); glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_SHORT, GL_TRUE, sizeof(VtxS), (void*)0); glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(VtxS), (void*)offsetof(VtxS, uv)); glEnableVertexAttribArray(2);
+    }
+    else if (fmt == VF_FULL) {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)0); glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, n)); glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, uv)); glEnableVertexAttribArray(2);
+    }
+    else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0); glEnableVertexAttribArray(0);
+    }
+}
+// 16-bit indices whenever every vertex is addressable with them
+static GLenum packIndices(const std::vector<unsigned int>& idx, size_t vertexCount, std::vector<unsigned char>& out) {
+    if (vertexCount <= 0x10000) {
+        out.resize(idx.size() * sizeof(uint16_t));
+        uint16_t* d = (uint16_t*)out.data();
+        for (size_t i = 0; i < idx.size(); ++i) d[i] = (uint16_t)idx[i];
+        return GL_UNSIGNED_SHORT;
+    }
+    out.resize(idx.size() * sizeof(unsigned int));
+    std::memcpy(out.data(), idx.data(), out.size());
+    return GL_UNSIGNED_INT;
+}
+static Mesh uploadMesh(uint32_t fmt, const void* verts, size_t vertexCount, const void* indices, int indexCount, GLenum indexType) {
+    Mesh m; m.indexCount = indexCount; m.indexType = indexType;
+    glGenVertexArrays(1, &m.VAO); glGenBuffers(1, &m.VBO); glGenBuffers(1, &m.EBO);
+    glBindVertexArray(m.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
+    gpuBufferData(GL_ARRAY_BUFFER, vertexCount * vertexStride(fmt), verts, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
+    gpuBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * (indexType == GL_UNSIGNED_SHORT ? 2 : 4), indices, GL_STATIC_DRAW);
+    setVertexLayout(fmt);
+    glBindVertexArray(0); return m;
+}
+static void drawMesh(const Mesh& m, GLenum mode = GL_TRIANGLES) {
+    glBindVertexArray(m.VAO);
+    glDrawElements(mode, m.indexCount, m.indexType, 0);
+}
+static glm::mat4 meshModel(const glm::mat4& M, const Mesh& m) {
+    return m.scale == 1.0f ? M : glm::scale(M, glm::vec3(m.scale));
+}
+
+// ===================== BAKED MESHES =====================
+// meshes/<name>.ssm: MeshFileHeader | vertices | indices, sections 64-byte aligned so the
+// mapped file is uploaded as-is. Bump kMeshFileVersion whenever a generator changes.
+static const uint32_t kMeshFileVersion = 2;
+static bool rebakeMeshes = false;          // --rebake-meshes
+static bool vtEnabled = true;              // --no-vt: vt=1 bodies fall back to fully resident textures
+
+struct MeshFileHeader {
+    char magic[4];                          // "SSMB"
+    uint32_t version, vertexFormat;
+    uint32_t vertexCount, vertexStride, indexCount, indexSize;
+    uint32_t vertexOffset, indexOffset;
+    uint32_t reserved[7];
+};
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader is part of the file format");
+
+static uint32_t alignUp(uint32_t x, uint32_t a) { return (x + a - 1) & ~(a - 1); }
+
+static bool writeMeshFile(const std::string& path, uint32_t fmt, const void* verts, size_t vertexCount,
+                          const std::vector<unsigned char>& indices, GLenum indexType) {
+    MeshFileHeader h{};
+    std::memcpy(h.magic, "SSMB", 4);
+    h.version = kMeshFileVersion; h.vertexFormat = fmt;
+    h.vertexCount = (uint32_t)vertexCount; h.vertexStride = (uint32_t)vertexStride(fmt);
+    h.indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    h.indexCount = (uint32_t)(indices.size() / h.indexSize);
+    h.vertexOffset = alignUp(sizeof(h), 64);
+    h.indexOffset = alignUp(h.vertexOffset + h.vertexCount * h.vertexStride, 64);
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    static const char zeros[64] = {};
+    f.write((const char*)&h, sizeof(h));
+    f.write(zeros, h.vertexOffset - sizeof(h));
+    f.write((const char*)verts, (std::streamsize)h.vertexCount * h.vertexStride);
+    f.write(zeros, h.indexOffset - (h.vertexOffset + h.vertexCount * h.vertexStride));
+    f.write((const char*)indices.data(), (std::streamsize)indices.size());
+    return (bool)f;
+}
+
+// CPU half of a mesh: either a mapped .ssm file or freshly generated bytes, ready for upload
+struct MeshData {
+    uint32_t fmt = 0;
+    MappedFile file;                                // set when the baked file was mapped
+    std::vector<unsigned char> vbytes, ibytes;      // set when the mesh was generated
+    size_t vertexOffset = 0, indexOffset = 0, vertexCount = 0;
+    int indexCount = 0; GLenum indexType = GL_UNSIGNED_INT;
+};
+
+static bool mapMeshFile(const std::string& path, uint32_t fmt, MeshData& d) {
+    if (!mapFile(path.c_str(), d.file)) return false;
+    MeshFileHeader h;
+    bool ok = d.file.size >= sizeof(h);
+    if (ok) {
+        std::memcpy(&h, d.file.data, sizeof(h));
+        ok = std::memcmp(h.magic, "SSMB", 4) == 0 && h.version == kMeshFileVersion && h.vertexFormat == fmt
+            && h.vertexStride == vertexStride(fmt) && (h.indexSize == 2 || h.indexSize == 4)
+            && (uint64_t)h.vertexOffset + (uint64_t)h.vertexCount * h.vertexStride <= d.file.size
+            && (uint64_t)h.indexOffset + (uint64_t)h.indexCount * h.indexSize <= d.file.size;
+    }
+    if (!ok) { unmapFile(d.file); return false; }
+    d.fmt = fmt; d.vertexOffset = h.vertexOffset; d.indexOffset = h.indexOffset;
+    d.vertexCount = h.vertexCount; d.indexCount = (int)h.indexCount;
+    d.indexType = h.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    // fault the pages in here so the GL thread does not stall on them during upload
+    volatile unsigned char sink = 0;
+    for (size_t o = 0; o < d.file.size; o += 4096) sink = sink ^ d.file.data[o];
+    return true;
+}
+
+// maps meshes/<name>.ssm; generates and bakes it when missing or stale. Needs no GL context.
+template <class V, class Gen>
+static MeshData prepareMesh(const char* name, uint32_t fmt, Gen gen) {
+    TimelineScope ts(std::string("mesh ") + name);
+    std::string path = std::string("meshes/") + name + ".ssm";
+    MeshData d;
+    if (!rebakeMeshes && mapMeshFile(path, fmt, d)) { ts.name += " (mapped)"; return d; }
+    ts.name += " (baked)";
+    std::vector<V> v; std::vector<unsigned int> idx;
+    gen(v, idx);
+    d.fmt = fmt; d.vertexCount = v.size(); d.indexCount = (int)idx.size();
+    d.indexType = packIndices(idx, v.size(), d.ibytes);
+    d.vbytes.assign((const unsigned char*)v.data(), (const unsigned char*)(v.data() + v.size()));
+    makeDir("meshes");
+    if (!writeMeshFile(path, fmt, v.data(), v.size(), d.ibytes, d.indexType)) std::cerr << "Mesh bake failed: " << path << "\n";
+    return d;
+}
+
+static Mesh uploadMeshData(MeshData d) {
+    const unsigned char* vb = d.file.data ? d.file.data + d.vertexOffset : d.vbytes.data();
+    const unsigned char* ib = d.file.data ? d.file.data + d.indexOffset : d.ibytes.data();
+    Mesh m = uploadMesh(d.fmt, vb, d.vertexCount, ib, d.indexCount, d.indexType);
+    unmapFile(d.file);
+    return m;
+}
+static Mesh withScale(Mesh m, float scale) { m.scale = scale; return m; }
+
+static MeshData prepareSphere(int stacks, int slices) {
+    char name[48]; std::snprintf(name, sizeof(name), "sphere_%dx%d", stacks, slices);
+    return prepareMesh<VtxS>(name, VF_SPHERE_S16,
+        [&](std::vector<VtxS>& v, std::vector<unsigned int>& idx) { genSphere(stacks, slices, v, idx); });
+}
+
+static MeshData prepareRing(int segments, float innerR, float outerR) {
+    char name[48]; std::snprintf(name, sizeof(name), "ring_%d_%.2f_%.2f", segments, innerR, outerR);
+    return prepareMesh<Vtx>(name, VF_FULL,
+        [&](std::vector<Vtx>& v, std::vector<unsigned int>& idx) { genRing(segments, innerR, outerR, v, idx); });
+}
+
+static MeshData prepareOrbitLine(int segments, float r, float e = 0.0f) {
+    char name[48];
+    if (e > 0.0f) std::snprintf(name, sizeof(name), "orbit_%d_%.2f_e%.4f", segments, r, e);
+    else std::snprintf(name, sizeof(name), "orbit_%d_%.2f", segments, r);
+    return prepareMesh<glm::vec3>(name, VF_POS,
+        [&](std::vector<glm::vec3>& p, std::vector<unsigned int>& idx) { genOrbitLine(segments, r, p, idx, e); });
+}
+
+// ===================== VIRTUAL TEXTURING =====================
+// Large equirectangular maps are baked once into a mip-tiled cache (vt/<name>.vtc) and
+// streamed into a fixed pool of physical pages on demand. A low-res feedback pass writes
+// the (tile, mip) every VT fragment wants; the CPU reads it back a frame later, pages in the
+// missing tiles coarsest-first and points the page table at the best resident ancestor.
+static const int kVtTile = 120, kVtBorder = 4, kVtPage = kVtTile + 2 * kVtBorder;   // 128x128 pages
+static const int kVtPoolPages = 16;                                                  // 16x16 pages = 2048^2 RGBA8
+static const int kVtMaxMips = 16;
+static const int kVtTableWidth = 256;
+static const int kVtFeedbackDiv = 8;             // feedback target is 1/8 of the framebuffer
+static const int kVtLoadsPerFrame = 8, kVtMaxInFlight = 32;
+static const uint32_t kVtFileVersion = 2;
+
+struct VtFileHeader {
+    char magic[4];                               // "SSVT"
+    uint32_t version, width, height, mipCount, tileCount, pageBytes, dataOffset;
+    int64_t sourceTime, sourceSize;              // stamp of the image it was baked from
+    uint32_t reserved[4];
+};
+static_assert(sizeof(VtFileHeader) == 64, "VtFileHeader is part of the file format");
+
+// tiles are stored mip 0 first, row-major, one kVtPage^2 RGBA8 page each (border included)
+static bool bakeVirtualTexture(const char* src, const std::string& dst, int64_t srcTime, int64_t srcSize) {
+    TimelineScope ts(std::string("bake vt ") + src);
+    int w, h, ch;
+    stbi_set_flip_vertically_on_load_thread(1);
+    unsigned char* px = stbi_load(src, &w, &h, &ch, 4);
+    if (!px) { std::cerr << "VT bake failed: " << src << " (" << stbi_failure_reason() << ")\n"; return false; }
+    std::vector<unsigned char> level(px, px + (size_t)w * h * 4);
+    stbi_image_free(px);
+
+    VtFileHeader hd{};
+    std::memcpy(hd.magic, "SSVT", 4);
+    hd.version = kVtFileVersion; hd.width = (uint32_t)w; hd.height = (uint32_t)h;
+    hd.pageBytes = kVtPage * kVtPage * 4; hd.dataOffset = 4096;
+    hd.sourceTime = srcTime; hd.sourceSize = srcSize;
+    for (int l = 0; l < kVtMaxMips; ++l) {
+        int lw = std::max(1, w >> l), lh = std::max(1, h >> l);
+        int tx = (lw + kVtTile - 1) / kVtTile, ty = (lh + kVtTile - 1) / kVtTile;
+        hd.mipCount++; hd.tileCount += tx * ty;
+        if (tx == 1 && ty == 1) break;
+    }
+
+    makeDir("vt");
+    std::ofstream f(dst, std::ios::binary);
+    if (!f) return false;
+    std::vector<char> pad(hd.dataOffset - sizeof(hd), 0);
+    f.write((const char*)&hd, sizeof(hd));
+    f.write(pad.data(), pad.size());
+    std::vector<unsigned char> page((size_t)hd.pageBytes);
+    int lw = w, lh = h;
+    for (uint32_t l = 0; l < hd.mipCount; ++l) {
+        int tilesX = (lw + kVtTile - 1) / kVtTile, tilesY = (lh + kVtTile - 1) / kVtTile;
+        for (int ty = 0; ty < tilesY; ++ty)
+            for (int tx = 0; tx < tilesX; ++tx) {
+                // equirect maps wrap in u and clamp in v
+                for (int y = 0; y < kVtPage; ++y) {
+                    int sy = glm::clamp(ty * kVtTile + y - kVtBorder, 0, lh - 1);
+                    for (int x = 0; x < kVtPage; ++x) {
+                        int sx = ((tx * kVtTile + x - kVtBorder) % lw + lw) % lw;
+                        std::memcpy(&page[((size_t)y * kVtPage + x) * 4], &level[((size_t)sy * lw + sx) * 4], 4);
+                    }
+                }
+                f.write((const char*)page.data(), page.size());
+            }
+        std::vector<unsigned char> next;
+        halveImage(level.data(), lw, lh, 4, next);
+        level.swap(next); lw = std::max(1, lw >> 1); lh = std::max(1, lh >> 1);
+    }
+    return (bool)f;
+}
+
+static bool validVtFile(const MappedFile& f, VtFileHeader& h) {
+    if (f.size < sizeof(h)) return false;
+    std::memcpy(&h, f.data, sizeof(h));
+    return std::memcmp(h.magic, "SSVT", 4) == 0 && h.version == kVtFileVersion && h.mipCount > 0
+        && h.mipCount <= (uint32_t)kVtMaxMips && h.pageBytes == (uint32_t)(kVtPage * kVtPage * 4)
+        && (uint64_t)h.dataOffset + (uint64_t)h.tileCount * h.pageBytes <= f.size;
+}
+
+// <any dir>/<name>.<ext> -> <dir>/<name><ext>
+static std::string cachePath(const std::string& source, const char* dir, const char* ext) {
+    size_t slash = source.find_last_of("/\\"), dot = source.find_last_of('.');
+    size_t b = slash == std::string::npos ? 0 : slash + 1;
+    if (dot == std::string::npos || dot < b) dot = source.size();
+    return std::string(dir) + "/" + source.substr(b, dot - b) + ext;
+}
+static std::string vtCachePath(const std::string& texture) { return cachePath(texture, "vt", ".vtc"); }
+
+// worker-side: rebake vt/<name>.vtc when it is missing, from another build or older than its image
+static bool ensureVirtualTextureCache(const char* src, const std::string& dst) {
+    int64_t t = 0, n = 0;
+    bool haveSrc = fileStamp(src, t, n);
+    MappedFile f; VtFileHeader h;
+    bool ok = mapFile(dst.c_str(), f) && validVtFile(f, h) && (!haveSrc || (h.sourceTime == t && h.sourceSize == n));
+    unmapFile(f);
+    return ok || (haveSrc && bakeVirtualTexture(src, dst, t, n));
+}
+
+struct VirtualTexture {
+    MappedFile file; VtFileHeader h{};
+    int mipW[kVtMaxMips] = {}, mipH[kVtMaxMips] = {}, tilesX[kVtMaxMips] = {}, tilesY[kVtMaxMips] = {}, mipBase[kVtMaxMips] = {};
+    std::vector<int> page;                 // per tile: physical page or -1
+    std::vector<char> loading;
+    std::vector<unsigned char> table;      // RGBA8UI: page x, page y, mip actually mapped, 1
+    GLuint tableTex = 0; int tableH = 0; bool tableDirty = true;
+};
+
+struct VtLoad { int vt, tile, page; std::future<void> ready; };
+
+struct VtSystem {
+    std::vector<VirtualTexture> vts;
+    GLuint poolTex = 0;
+    std::vector<int> pageVt, pageTile;     // owner of each physical page, -1 when free
+    std::vector<uint64_t> pageUsed;
+    std::vector<char> pagePinned;
+    std::vector<VtLoad> inFlight;
+    // feedback target + ping-pong PBOs so the readback never waits on the GPU
+    GLuint fbo = 0, fbColor = 0, fbDepth = 0, pbo[2] = { 0, 0 };
+    int fbW = 0, fbH = 0, fbFrame = 0; bool pboFull[2] = { false, false };
+    int residentCount = 0, loadsTotal = 0, evictions = 0;
+};
+
+static void vtInit(VtSystem& vs) {
+    const int n = kVtPoolPages * kVtPoolPages;
+    vs.pageVt.assign(n, -1); vs.pageTile.assign(n, -1); vs.pageUsed.assign(n, 0); vs.pagePinned.assign(n, 0);
+    glGenTextures(1, &vs.poolTex); glBindTexture(GL_TEXTURE_2D, vs.poolTex);
+    gpuTexImage2D(0, GL_RGBA8, kVtPage * kVtPoolPages, kVtPage * kVtPoolPages, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenBuffers(2, vs.pbo);
+}
+
+static int vtTileIndex(const VirtualTexture& vt, int l, int tx, int ty) { return vt.mipBase[l] + ty * vt.tilesX[l] + tx; }
+
+static void vtUploadPage(VtSystem& vs, int vtIndex, int tile, int page) {
+    VirtualTexture& vt = vs.vts[vtIndex];
+    glBindTexture(GL_TEXTURE_2D, vs.poolTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (page % kVtPoolPages) * kVtPage, (page / kVtPoolPages) * kVtPage, kVtPage, kVtPage,
+                    GL_RGBA, GL_UNSIGNED_BYTE, vt.file.data + vt.h.dataOffset + (size_t)tile * vt.h.pageBytes);
+    vt.page[tile] = page; vt.tableDirty = true;
+    vs.pageVt[page] = vtIndex; vs.pageTile[page] = tile;
+    vs.residentCount++; vs.loadsTotal++;
+}
+
+// free page, or the least recently used unpinned page that was not needed this frame
+static int vtAllocPage(VtSystem& vs, uint64_t frame) {
+    int best = -1;
+    for (int p = 0; p < (int)vs.pageVt.size(); ++p) {
+        if (vs.pagePinned[p]) continue;
+        if (vs.pageVt[p] < 0) return p;
+        if (vs.pageTile[p] >= 0 && vs.pageUsed[p] < frame && (best < 0 || vs.pageUsed[p] < vs.pageUsed[best])) best = p;
+    }
+    if (best >= 0) {
+        VirtualTexture& old = vs.vts[vs.pageVt[best]];
+        old.page[vs.pageTile[best]] = -1; old.tableDirty = true;
+        vs.pageVt[best] = -1; vs.pageTile[best] = -1;
+        vs.residentCount--; vs.evictions++;
+    }
+    return best;
+}
+
+static int vtOpen(VtSystem& vs, const std::string& path) {
+    VirtualTexture vt;
+    if (!mapFile(path.c_str(), vt.file) || !validVtFile(vt.file, vt.h)) { unmapFile(vt.file); return -1; }
+    int base = 0;
+    for (uint32_t l = 0; l < vt.h.mipCount; ++l) {
+        vt.mipW[l] = std::max(1, (int)vt.h.width >> l); vt.mipH[l] = std::max(1, (int)vt.h.height >> l);
+        vt.tilesX[l] = (vt.mipW[l] + kVtTile - 1) / kVtTile; vt.tilesY[l] = (vt.mipH[l] + kVtTile - 1) / kVtTile;
+        vt.mipBase[l] = base; base += vt.tilesX[l] * vt.tilesY[l];
+    }
+    vt.page.assign(base, -1); vt.loading.assign(base, 0);
+    vt.tableH = (base + kVtTableWidth - 1) / kVtTableWidth;
+    vt.table.assign((size_t)kVtTableWidth * vt.tableH * 4, 0);
+    glGenTextures(1, &vt.tableTex); glBindTexture(GL_TEXTURE_2D, vt.tableTex);
+    gpuTexImage2D(0, GL_RGBA8UI, kVtTableWidth, vt.tableH, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    vs.vts.push_back(std::move(vt));
+    // the single top-mip tile is always resident so every lookup has a fallback
+    int index = (int)vs.vts.size() - 1, top = base - 1, page = vtAllocPage(vs, 0);
+    if (page < 0) return -1;
+    vtUploadPage(vs, index, top, page);
+    vs.pagePinned[page] = 1;
+    return index;
+}
+
+static void vtRebuildTable(VirtualTexture& vt) {
+    for (int l = (int)vt.h.mipCount - 1; l >= 0; --l)
+        for (int ty = 0; ty < vt.tilesY[l]; ++ty)
+            for (int tx = 0; tx < vt.tilesX[l]; ++tx) {
+                unsigned char* e = &vt.table[(size_t)vtTileIndex(vt, l, tx, ty) * 4];
+                int p = vt.page[vtTileIndex(vt, l, tx, ty)];
+                if (p >= 0) { e[0] = (unsigned char)(p % kVtPoolPages); e[1] = (unsigned char)(p / kVtPoolPages); e[2] = (unsigned char)l; e[3] = 1; }
+                else if (l + 1 < (int)vt.h.mipCount) {
+                    int px = std::min(tx / 2, vt.tilesX[l + 1] - 1), py = std::min(ty / 2, vt.tilesY[l + 1] - 1);
+                    std::memcpy(e, &vt.table[(size_t)vtTileIndex(vt, l + 1, px, py) * 4], 4);
+                }
+            }
+    glBindTexture(GL_TEXTURE_2D, vt.tableTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kVtTableWidth, vt.tableH, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, vt.table.data());
+    vt.tableDirty = false;
+}
+
+static void vtResizeFeedback(VtSystem& vs, int w, int h) {
+    w = std::max(1, w / kVtFeedbackDiv); h = std::max(1, h / kVtFeedbackDiv);
+    if (w == vs.fbW && h == vs.fbH) return;
+    vs.fbW = w; vs.fbH = h; vs.pboFull[0] = vs.pboFull[1] = false;
+    if (!vs.fbo) { glGenFramebuffers(1, &vs.fbo); glGenTextures(1, &vs.fbColor); glGenRenderbuffers(1, &vs.fbDepth); }
+    glBindTexture(GL_TEXTURE_2D, vs.fbColor);
+    gpuTexImage2D(0, GL_RGBA16UI, w, h, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindRenderbuffer(GL_RENDERBUFFER, vs.fbDepth);
+    gpuRenderbufferStorage(GL_DEPTH_COMPONENT24, w, h);
+    glBindFramebuffer(GL_FRAMEBUFFER, vs.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, vs.fbColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, vs.fbDepth);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (GLuint b : vs.pbo) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, b);
+        gpuBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)w * h * 8, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// called right after the feedback pass: queue this frame's readback, consume last frame's
+static void vtReadFeedback(VtSystem& vs, TaskPool& pool, uint64_t frame) {
+    int cur = vs.fbFrame & 1, prev = cur ^ 1;
+    vs.fbFrame++;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, vs.fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, vs.pbo[cur]);
+    glReadPixels(0, 0, vs.fbW, vs.fbH, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+    vs.pboFull[cur] = true;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    std::vector<uint64_t> wanted;
+    if (vs.pboFull[prev]) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vs.pbo[prev]);
+        const uint16_t* px = (const uint16_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (px) {
+            std::vector<uint64_t> seen;
+            for (int i = 0; i < vs.fbW * vs.fbH; ++i) {
+                const uint16_t* r = px + i * 4;
+                if (r[3] == 0 || r[3] > vs.vts.size()) continue;
+                seen.push_back(((uint64_t)(r[3] - 1) << 48) | ((uint64_t)r[2] << 40) | ((uint64_t)r[1] << 20) | r[0]);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            std::sort(seen.begin(), seen.end());
+            seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+            // walk each request up its mip chain: touch what is resident, collect what is missing
+            for (uint64_t key : seen) {
+                int v = (int)(key >> 48), l = (int)((key >> 40) & 0xff), ty = (int)((key >> 20) & 0xfffff), tx = (int)(key & 0xfffff);
+                VirtualTexture& vt = vs.vts[v];
+                if (l >= (int)vt.h.mipCount || tx >= vt.tilesX[l] || ty >= vt.tilesY[l]) continue;
+                for (;;) {
+                    int t = vtTileIndex(vt, l, tx, ty);
+                    if (vt.page[t] >= 0) { vs.pageUsed[vt.page[t]] = frame; break; }
+                    if (!vt.loading[t]) wanted.push_back(((uint64_t)l << 56) | ((uint64_t)v << 48) | (uint64_t)t);
+                    if (++l >= (int)vt.h.mipCount) break;
+                    tx = std::min(tx / 2, vt.tilesX[l] - 1); ty = std::min(ty / 2, vt.tilesY[l] - 1);
+                }
+            }
+        }
+        vs.pboFull[prev] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // coarsest mips first so a fallback is always on its way before the detail
+    std::sort(wanted.begin(), wanted.end(), [](uint64_t a, uint64_t b) { return a > b; });
+    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+    int issued = 0;
+    for (uint64_t w : wanted) {
+        if (issued >= kVtLoadsPerFrame || (int)vs.inFlight.size() >= kVtMaxInFlight) break;
+        int v = (int)((w >> 48) & 0xff), t = (int)(w & 0xffffffffffull);
+        int page = vtAllocPage(vs, frame);
+        if (page < 0) break;
+        VirtualTexture& vt = vs.vts[v];
+        vt.loading[t] = 1;
+        vs.pageVt[page] = v; vs.pageTile[page] = -1; vs.pageUsed[page] = frame;   // reserved until the upload lands
+        const unsigned char* src = vt.file.data + vt.h.dataOffset + (size_t)t * vt.h.pageBytes;
+        size_t bytes = vt.h.pageBytes;
+        // fault the tile in on a worker; the GL thread then uploads straight from the mapping
+        std::future<void> ready = pool.submit([src, bytes] {
+            volatile unsigned char sink = 0;
+            for (size_t o = 0; o < bytes; o += 4096) sink = sink ^ src[o];
+        });
+        vs.inFlight.push_back({ v, t, page, std::move(ready) });
+        ++issued;
+    }
+}
+
+// upload finished loads (bounded by kVtMaxInFlight) and refresh dirty page tables
+static void vtUpdate(VtSystem& vs) {
+    for (size_t i = 0; i < vs.inFlight.size();) {
+        VtLoad& ld = vs.inFlight[i];
+        if (ld.ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { ++i; continue; }
+        vs.vts[ld.vt].loading[ld.tile] = 0;
+        vtUploadPage(vs, ld.vt, ld.tile, ld.page);
+        ld = std::move(vs.inFlight.back()); vs.inFlight.pop_back();
+    }
+    for (VirtualTexture& vt : vs.vts)
+        if (vt.tableDirty) vtRebuildTable(vt);
+}
+
+// shared by the lit shader and the feedback shader; constants mirror kVtTile/kVtBorder/kVtPage/kVtPoolPages
+static const char* vtGlsl = R"(
+uniform vec2 vtMipSize[16];
+uniform int vtMipBase[16], vtTilesX[16], vtTilesY[16];
+uniform int vtMips;
+uniform float vtLodBias;
+const float VT_TILE = 120.0, VT_BORDER = 4.0, VT_PAGE = 128.0, VT_POOL = 16.0;
+const int VT_TABLE_W = 256;
+int vtLevel(vec2 uv){
+  vec2 t = uv * vtMipSize[0];
+  vec2 dx = dFdx(t), dy = dFdy(t);
+  float lod = 0.5 * log2(max(max(dot(dx,dx), dot(dy,dy)), 1e-8)) + vtLodBias;
+  return clamp(int(floor(lod)), 0, vtMips - 1);
+}
+ivec2 vtTileOf(vec2 uv, int l){
+  ivec2 t = ivec2(clamp(uv, 0.0, 1.0) * vtMipSize[l] / VT_TILE);
+  return min(t, ivec2(vtTilesX[l], vtTilesY[l]) - 1);
+}
+)";
+
+static const char* fsVtFeedback = R"(#version 330 core
+out uvec4 Request;
+in vec3 FragPos; in vec3 Normal; in vec2 UV;
+uniform uint vtId;
+void main(){
+  int l = vtLevel(UV);
+  Request = uvec4(uvec2(vtTileOf(UV, l)), uint(l), vtId);
+})";
+
+struct VtUniforms { GLint mipSize, mipBase, tilesX, tilesY, mips, lodBias; };
+static VtUniforms vtUniforms(GLuint prog) {
+    return { glGetUniformLocation(prog, "vtMipSize"), glGetUniformLocation(prog, "vtMipBase"),
+             glGetUniformLocation(prog, "vtTilesX"), glGetUniformLocation(prog, "vtTilesY"),
+             glGetUniformLocation(prog, "vtMips"), glGetUniformLocation(prog, "vtLodBias") };
+}
+static void vtSetUniforms(const VtUniforms& u, const VirtualTexture& vt, float lodBias) {
+    GLsizei n = (GLsizei)vt.h.mipCount;
+    float sizes[kVtMaxMips * 2];
+    for (int l = 0; l < n; ++l) { sizes[l * 2] = (float)vt.mipW[l]; sizes[l * 2 + 1] = (float)vt.mipH[l]; }
+    glUniform2fv(u.mipSize, n, sizes);
+    glUniform1iv(u.mipBase, n, vt.mipBase);
+    glUniform1iv(u.tilesX, n, vt.tilesX);
+    glUniform1iv(u.tilesY, n, vt.tilesY);
+    glUniform1i(u.mips, n);
+    glUniform1f(u.lodBias, lodBias);
+}
+
+// ===================== SHADER VARIANTS =====================
+// fsSrc is written once with #ifdef blocks; each combination of LitFeature bits is compiled as
+// its own program the first time a draw asks for it, so no fragment branches on what a material
+// is. Linked programs are saved to shaders/lit_<bits>.spb (GL_ARB_get_program_binary) and loaded
+// from there on later runs; a source or driver change makes the cached binary miss.
+enum LitFeature : uint32_t {
+    LIT_TEXTURED = 1, LIT_VIRTUAL_TEXTURE = 2, LIT_EMISSIVE = 4, LIT_UNLIT = 8, LIT_RING_ALPHA = 16, LIT_ECLIPSE = 32,
+    LIT_CLUSTERED_LIGHTS = 64
+};
+static const char* const kLitFeatureDefines[] = { "TEXTURED", "VIRTUAL_TEXTURE", "EMISSIVE", "UNLIT", "RING_ALPHA", "ECLIPSE",
+                                                  "CLUSTERED_LIGHTS" };
+static const int kLitFeatureCount = (int)(sizeof(kLitFeatureDefines) / sizeof(kLitFeatureDefines[0]));
+static const uint32_t kProgramCacheVersion = 1;
+static const int kClusterX = 16, kClusterY = 9, kClusterZ = 24;     // light cluster grid, see LIGHT CLUSTERS
+
+struct ProgramCacheHeader {
+    char magic[4];                               // "SSPB"
+    uint32_t version, format, length;
+    uint64_t sourceHash, driverHash;
+};
+static_assert(sizeof(ProgramCacheHeader) == 32, "ProgramCacheHeader is part of the file format");
+
+// uniforms shared by every draw in a frame; a variant takes them once per frame, on first use
+struct LitFrame {
+    glm::mat4 view, proj;
+    glm::vec3 lightPos, lightColor, viewPos;
+    float lightRadius;
+    glm::vec4 clusterParams;
+    uint64_t frame;
+};
+
+struct LitProgram {
+    GLuint prog = 0;
+    GLint model, view, projection, lightPos, lightColor, viewPos;
+    GLint baseColor, emissive, shininess, ks, lightRadius, occluders, occluderCount, clusterParams;
+    VtUniforms vt;
+    uint64_t frame = ~0ull;                      // last frame its LitFrame uniforms were set
+};
+
+struct ShaderVariants {
+    std::unordered_map<uint32_t, LitProgram> programs;
+    uint64_t driverHash = 0;
+    bool binaryCache = false;
+    int compiled = 0, cached = 0;                // variants linked from source / restored from shaders/
+};
+
+static void shaderVariantsInit(ShaderVariants& sv) {
+    GLint formats = 0;
+    if (GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    sv.binaryCache = formats > 0;
+    sv.driverHash = fnv1a("", 0);
+    for (GLenum e : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* s = (const char*)glGetString(e);
+        if (s) sv.driverHash = fnv1a(s, std::strlen(s), sv.driverHash);
+    }
+}
+
+static std::string litSource(uint32_t bits) {
+    std::string defs;
+    for (int i = 0; i < kLitFeatureCount; ++i)
+        if (bits & (1u << i)) defs += std::string("#define ") + kLitFeatureDefines[i] + "\n";
+    if (bits & LIT_CLUSTERED_LIGHTS) {
+        char dims[96];
+        std::snprintf(dims, sizeof(dims), "#define CLUSTER_X %d\n#define CLUSTER_Y %d\n#define CLUSTER_Z %d\n", kClusterX, kClusterY, kClusterZ);
+        defs += dims;
+    }
+    if (bits & LIT_VIRTUAL_TEXTURE) defs += vtGlsl;
+    return withGlsl(fsSrc, defs.c_str());
+}
+
+static GLuint loadProgramBinary(const ShaderVariants& sv, const std::string& path, uint64_t sourceHash) {
+    MappedFile f;
+    if (!mapFile(path.c_str(), f)) return 0;
+    ProgramCacheHeader h;
+    GLuint p = 0;
+    if (f.size >= sizeof(h)) {
+        std::memcpy(&h, f.data, sizeof(h));
+        if (std::memcmp(h.magic, "SSPB", 4) == 0 && h.version == kProgramCacheVersion && h.sourceHash == sourceHash
+            && h.driverHash == sv.driverHash && sizeof(h) + (uint64_t)h.length <= f.size) {
+            p = glCreateProgram();
+            glProgramBinary(p, h.format, f.data + sizeof(h), (GLsizei)h.length);
+            GLint ok = 0; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+            if (!ok) { glDeleteProgram(p); p = 0; }   // the driver may reject its own old binaries
+        }
+    }
+    unmapFile(f);
+    return p;
+}
+
+static void saveProgramBinary(const ShaderVariants& sv, GLuint p, const std::string& path, uint64_t sourceHash) {
+    GLint length = 0; glGetProgramiv(p, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> blob((size_t)length);
+    ProgramCacheHeader h{};
+    std::memcpy(h.magic, "SSPB", 4);
+    GLenum format = 0;
+    glGetProgramBinary(p, length, nullptr, &format, blob.data());
+    h.version = kProgramCacheVersion; h.format = format; h.length = (uint32_t)length;
+    h.sourceHash = sourceHash; h.driverHash = sv.driverHash;
+    makeDir("shaders");
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char*)&h, sizeof(h));
+    f.write(blob.data(), (std::streamsize)blob.size());
+}
+
+static LitProgram& litProgram(ShaderVariants& sv, uint32_t bits) {
+    if (bits & LIT_UNLIT) bits &= ~(uint32_t)LIT_CLUSTERED_LIGHTS;   // unlit takes no lights; fsSrc only has them under #ifndef UNLIT
+    auto it = sv.programs.find(bits);
+    if (it != sv.programs.end()) return it->second;
+    std::string fs = litSource(bits);
+    uint64_t hash = fnv1a(fs.data(), fs.size(), fnv1a(vsSrc, std::strlen(vsSrc)));
+    char path[64]; std::snprintf(path, sizeof(path), "shaders/lit_%02x.spb", bits);
+    LitProgram lp;
+    if (sv.binaryCache) lp.prog = loadProgramBinary(sv, path, hash);
+    if (lp.prog) ++sv.cached;
+    else {
+        TimelineScope ts(std::string("compile ") + path);
+        lp.prog = glCreateProgram();
+        GLuint v = makeShader(GL_VERTEX_SHADER, vsSrc), f = makeShader(GL_FRAGMENT_SHADER, fs.c_str());
+        glAttachShader(lp.prog, v); glAttachShader(lp.prog, f);
+        if (sv.binaryCache) glProgramParameteri(lp.prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(lp.prog);
+        GLint ok; glGetProgramiv(lp.prog, GL_LINK_STATUS, &ok);
+        if (!ok) { char log[1024]; glGetProgramInfoLog(lp.prog, 1024, nullptr, log); std::cerr << "Link " << path << ": " << log << "\n"; }
+        glDeleteShader(v); glDeleteShader(f);
+        if (ok && sv.binaryCache) saveProgramBinary(sv, lp.prog, path, hash);
+        ++sv.compiled;
+    }
+    auto loc = [&](const char* n) { return glGetUniformLocation(lp.prog, n); };
+    lp.model = loc("model"); lp.view = loc("view"); lp.projection = loc("projection");
+    lp.lightPos = loc("lightPos"); lp.lightColor = loc("lightColor"); lp.viewPos = loc("viewPos");
+    lp.baseColor = loc("baseColor"); lp.emissive = loc("emissive"); lp.shininess = loc("shininess"); lp.ks = loc("ks");
+    lp.lightRadius = loc("lightRadius"); lp.occluders = loc("occluders"); lp.occluderCount = loc("occluderCount");
+    lp.clusterParams = loc("clusterParams");
+    lp.vt = vtUniforms(lp.prog);
+    glUseProgram(lp.prog);
+    glUniform1i(loc("albedo"), 0);
+    glUniform1i(loc("vtPool"), 1);
+    glUniform1i(loc("vtTable"), 2);
+    glUniform1i(loc("lightData"), 3);                // units 3-5: lightClustersBind
+    glUniform1i(loc("clusterGrid"), 4);
+    glUniform1i(loc("lightIndices"), 5);
+    return sv.programs.emplace(bits, lp).first->second;
+}
+
+// binds the variant for `bits`, bringing its per-frame uniforms up to date
+static LitProgram& useLit(ShaderVariants& sv, uint32_t bits, const LitFrame& fr) {
+    LitProgram& lp = litProgram(sv, bits);
+    glUseProgram(lp.prog);
+    if (lp.frame != fr.frame) {
+        lp.frame = fr.frame;
+        glUniformMatrix4fv(lp.view, 1, GL_FALSE, glm::value_ptr(fr.view));
+        glUniformMatrix4fv(lp.projection, 1, GL_FALSE, glm::value_ptr(fr.proj));
+        glUniform3fv(lp.lightPos, 1, glm::value_ptr(fr.lightPos));
+        glUniform3fv(lp.lightColor, 1, glm::value_ptr(fr.lightColor));
+        glUniform3fv(lp.viewPos, 1, glm::value_ptr(fr.viewPos));
+        glUniform1f(lp.lightRadius, fr.lightRadius);
+        glUniform4fv(lp.clusterParams, 1, glm::value_ptr(fr.clusterParams));
+    }
+    return lp;
+}
+
+// ===================== TEXTURE RESIDENCY =====================
+// Keeps the plain albedo textures inside gpuBudgetBytes. Each frame the bodies report how many
+// pixels they cover; a texture whose top mip is denser than that is the first to give levels up.
+// Dropping reads level 1 back and respecifies it as level 0 of the same GL name, so every holder
+// of the handle keeps working. Restoring re-decodes the source on the pool and downsamples there.
+static const int kResMaxDrop = 4;                  // never below 1/16 of the source size
+static const float kResRestoreHeadroom = 0.9f;     // restores must leave 10% of the budget free
+
+struct MipImage { int w = 0, h = 0; std::vector<unsigned char> px; };
+struct ResidentTexture {
+    GLuint tex = 0; std::string path; int ch = 4;
+    int fullW = 0, fullH = 0;
+    int dropped = 0, wantDrop = 0;                 // levels missing now / levels the coverage can spare
+    float coveragePx = 0.0f;                       // largest projected radius of any body using it this frame
+    std::future<MipImage> restore; int restoreTo = 0;
+};
+struct ResidencyManager {
+    std::vector<ResidentTexture> textures;
+    int evictions = 0, restores = 0;
+};
+
+static void residencyTrack(ResidencyManager& rm, GLuint tex, const char* path) {
+    if (!tex) return;
+    const GpuTexRecord& r = gpuTextures[tex];
+    ResidentTexture t; t.tex = tex; t.path = path; t.fullW = r.w; t.fullH = r.h;
+    glBindTexture(GL_TEXTURE_2D, tex);
+    GLint fmt = GL_RGBA; glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &fmt);
+    t.ch = fmt == GL_RED || fmt == GL_R8 ? 1 : fmt == GL_RGB || fmt == GL_RGB8 ? 3 : 4;
+    rm.textures.push_back(std::move(t));
+}
+static float projectedRadiusPx(const glm::vec3& center, float radius, const glm::vec3& eye, float fov, int viewportH) {
+    float d = std::max(glm::length(center - eye), radius * 1.01f);
+    return radius / (d * tanf(glm::radians(fov) * 0.5f)) * viewportH * 0.5f;
+}
+static void residencyCover(ResidencyManager& rm, GLuint tex, float px) {
+    for (ResidentTexture& t : rm.textures)
+        if (t.tex == tex) t.coveragePx = std::max(t.coveragePx, px);
+}
+static size_t levelBytes(const ResidentTexture& t, int dropped) {
+    GpuTexRecord r; r.w = std::max(1, t.fullW >> dropped); r.h = std::max(1, t.fullH >> dropped);
+    r.bpp = texelBytes(imageFormat(t.ch)); r.mips = true;
+    return texRecordBytes(r);
+}
+static void respecifyTexture(ResidentTexture& t, int w, int h, const unsigned char* px) {
+    GLenum fmt = imageFormat(t.ch);
+    glBindTexture(GL_TEXTURE_2D, t.tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gpuTexImage2D(0, fmt, w, h, fmt, GL_UNSIGNED_BYTE, px);
+    gpuGenerateMipmap();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+// level 1 becomes level 0; glGetTexImage stalls on the texture, so at most one per frame
+static void dropTopMip(ResidentTexture& t) {
+    glBindTexture(GL_TEXTURE_2D, t.tex);
+    GLint w = 0, h = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 1, GL_TEXTURE_WIDTH, &w);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 1, GL_TEXTURE_HEIGHT, &h);
+    if (w <= 0 || h <= 0) return;
+    std::vector<unsigned char> px((size_t)w * h * t.ch);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 1, imageFormat(t.ch), GL_UNSIGNED_BYTE, px.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    respecifyTexture(t, w, h, px.data());
+    t.dropped++;
+}
+
+// call once per frame after the bodies have reported their coverage
+static void residencyUpdate(ResidencyManager& rm, TaskPool& pool) {
+    for (ResidentTexture& t : rm.textures) {
+        // the equator spans 2*pi*r pixels at most; anything denser than that is never sampled
+        float needW = std::max(1.0f, 6.2831853f * t.coveragePx);
+        t.wantDrop = glm::clamp((int)floorf(log2f(t.fullW / needW)), 0, kResMaxDrop);
+        t.coveragePx = 0.0f;
+        if (t.restore.valid() && t.restore.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            MipImage img = t.restore.get();
+            if (!img.px.empty() && t.restoreTo < t.dropped) {
+                respecifyTexture(t, img.w, img.h, img.px.data());
+                t.dropped = t.restoreTo; rm.restores++;
+            }
+        }
+    }
+
+    if (gpuUsedBytes() > gpuBudgetBytes) {
+        // over budget: textures with detail nobody can see go first, then the smallest on screen
+        ResidentTexture* victim = nullptr;
+        for (ResidentTexture& t : rm.textures) {
+            if (t.dropped >= kResMaxDrop || t.restore.valid()) continue;
+            bool spare = t.wantDrop > t.dropped;
+            if (!victim) { victim = &t; continue; }
+            bool vSpare = victim->wantDrop > victim->dropped;
+            if (spare != vSpare ? spare : t.wantDrop - t.dropped > victim->wantDrop - victim->dropped) victim = &t;
+        }
+        if (victim) { dropTopMip(*victim); rm.evictions++; }
+        return;
+    }
+
+    // under budget: bring back the most under-resolved texture if it still fits with headroom
+    ResidentTexture* best = nullptr;
+    for (ResidentTexture& t : rm.textures)
+        if (t.dropped > t.wantDrop && !t.restore.valid() && (!best || t.dropped - t.wantDrop > best->dropped - best->wantDrop)) best = &t;
+    if (!best) return;
+    size_t grow = levelBytes(*best, best->wantDrop) - levelBytes(*best, best->dropped);
+    if (gpuUsedBytes() + grow > (size_t)(gpuBudgetBytes * kResRestoreHeadroom)) return;
+    std::string path = best->path; int levels = best->wantDrop;
+    best->restoreTo = levels;
+    best->restore = pool.submit([path, levels] {
+        MipImage out;
+        ImageData img = decodeImage(path.c_str());
+        if (!img.pixels) return out;
+        out.w = img.w; out.h = img.h; out.px.assign(img.pixels, img.pixels + (size_t)img.w * img.h * img.ch);
+        int ch = img.ch;
+        stbi_image_free(img.pixels);
+        for (int l = 0; l < levels; ++l) {
+            std::vector<unsigned char> next;
+            halveImage(out.px.data(), out.w, out.h, ch, next);
+            out.px.swap(next); out.w = std::max(1, out.w >> 1); out.h = std::max(1, out.h >> 1);
+        }
+        return out;
+    });
+}
+
+// ===================== SKYBOX =====================
+// The equirectangular star map is resampled once into six cube faces (sky/<name>.sky: 64-byte header,
+// then +X -X +Y -Y +Z -Z as RGBA8) and mapped straight into a cubemap on later runs. The sky is drawn
+// after the opaque bodies as one fullscreen triangle on the far plane, so the depth test discards
+// every covered pixel before the (lighting-free) fragment shader runs.
+static const uint32_t kSkyFileVersion = 1;
+static const int kSkyMaxFace = 2048;
+
+struct SkyFileHeader {
+    char magic[4];                               // "SSSK"
+    uint32_t version, faceSize, dataOffset;
+    int64_t sourceTime, sourceSize;              // stamp of the image it was baked from
+    uint32_t reserved[8];
+};
+static_assert(sizeof(SkyFileHeader) == 64, "SkyFileHeader is part of the file format");
+
+// GL cube face conventions: s right, t down, both in [-1, 1]
+static glm::vec3 cubeFaceDir(int face, float s, float t) {
+    switch (face) {
+    case 0:  return glm::vec3(1, -t, -s);
+    case 1:  return glm::vec3(-1, -t, s);
+    case 2:  return glm::vec3(s, 1, t);
+    case 3:  return glm::vec3(s, -1, -t);
+    case 4:  return glm::vec3(s, -t, 1);
+    default: return glm::vec3(-s, -t, -1);
+    }
+}
+
+// bilinear lookup in an unflipped equirect map laid out like the sphere UVs: u wraps, row 0 is +Y
+static void sampleEquirect(const ImageData& img, glm::vec3 d, unsigned char* out) {
+    d = glm::normalize(d);
+    float u = std::atan2(d.z, d.x) / glm::two_pi<float>();
+    if (u < 0.0f) u += 1.0f;
+    float v = std::acos(glm::clamp(d.y, -1.0f, 1.0f)) / glm::pi<float>();
+    float fx = u * img.w - 0.5f, fy = v * img.h - 0.5f;
+    int x0 = (int)std::floor(fx), y0 = (int)std::floor(fy);
+    float ax = fx - x0, ay = fy - y0;
+    int x1 = ((x0 + 1) % img.w + img.w) % img.w, y1 = glm::clamp(y0 + 1, 0, img.h - 1);
+    x0 = (x0 % img.w + img.w) % img.w; y0 = glm::clamp(y0, 0, img.h - 1);
+    auto px = [&](int x, int y, int c) { return (float)img.pixels[((size_t)y * img.w + x) * img.ch + std::min(c, img.ch - 1)]; };
+    for (int c = 0; c < 3; ++c) {
+        float top = px(x0, y0, c) + (px(x1, y0, c) - px(x0, y0, c)) * ax;
+        float bot = px(x0, y1, c) + (px(x1, y1, c) - px(x0, y1, c)) * ax;
+        out[c] = (unsigned char)(top + (bot - top) * ay + 0.5f);
+    }
+    out[3] = 255;
+}
+
+// faces get a quarter of the map's width, so texel density roughly matches the source at the equator
+static bool bakeSkybox(const char* src, const std::string& dst, int64_t srcTime, int64_t srcSize) {
+    TimelineScope ts(std::string("bake skybox ") + src);
+    ImageData img = decodeImage(src, false);
+    if (!img.pixels) return false;
+    SkyFileHeader hd{};
+    std::memcpy(hd.magic, "SSSK", 4);
+    hd.version = kSkyFileVersion; hd.faceSize = (uint32_t)glm::clamp(img.w / 4, 1, kSkyMaxFace);
+    hd.dataOffset = sizeof(hd); hd.sourceTime = srcTime; hd.sourceSize = srcSize;
+    const int n = (int)hd.faceSize;
+    std::vector<unsigned char> face((size_t)n * n * 4);
+
+    makeDir("sky");
+    std::ofstream f(dst, std::ios::binary);
+    if (!f) { stbi_image_free(img.pixels); return false; }
+    f.write((const char*)&hd, sizeof(hd));
+    for (int k = 0; k < 6; ++k) {
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x)
+                sampleEquirect(img, cubeFaceDir(k, 2.0f * (x + 0.5f) / n - 1.0f, 2.0f * (y + 0.5f) / n - 1.0f),
+                               &face[((size_t)y * n + x) * 4]);
+        f.write((const char*)face.data(), (std::streamsize)face.size());
+    }
+    stbi_image_free(img.pixels);
+    return (bool)f;
+}
+
+static bool validSkyFile(const MappedFile& f, SkyFileHeader& h) {
+    if (f.size < sizeof(h)) return false;
+    std::memcpy(&h, f.data, sizeof(h));
+    return std::memcmp(h.magic, "SSSK", 4) == 0 && h.version == kSkyFileVersion
+        && h.faceSize > 0 && h.faceSize <= (uint32_t)kSkyMaxFace
+        && (uint64_t)h.dataOffset + 6ull * h.faceSize * h.faceSize * 4 <= f.size;
+}
+
+// worker-side: rebake when the cache is missing, from another build or older than its image
+static bool ensureSkyboxCache(const char* src, const std::string& dst) {
+    int64_t t = 0, n = 0;
+    bool haveSrc = fileStamp(src, t, n);
+    MappedFile f; SkyFileHeader h;
+    bool ok = mapFile(dst.c_str(), f) && validSkyFile(f, h) && (!haveSrc || (h.sourceTime == t && h.sourceSize == n));
+    unmapFile(f);
+    return ok || (haveSrc && bakeSkybox(src, dst, t, n));
+}
+
+static GLuint uploadSkybox(const std::string& path) {
+    TimelineScope ts("upload skybox");
+    MappedFile f; SkyFileHeader h;
+    if (!mapFile(path.c_str(), f) || !validSkyFile(f, h)) { unmapFile(f); return 0; }
+    const int n = (int)h.faceSize;
+    GLuint t; glGenTextures(1, &t); glBindTexture(GL_TEXTURE_CUBE_MAP, t);
+    for (int k = 0; k < 6; ++k)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     f.data + h.dataOffset + (size_t)k * n * n * 4);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    GpuTexRecord r; r.w = r.h = n; r.bpp = 4; r.mips = true; r.faces = 6;
+    setTexRecord(t, r);
+    unmapFile(f);
+    return t;
+}
+
+// ===================== STAR CATALOG =====================
+// Stars are points, not texels: a catalog of unit directions, magnitudes and B-V colour indices,
+// compiled to stars/<name>.sst (64-byte header + 8-byte records sorted brightest first) and
+// mapped straight into one vertex buffer. Whatever is brighter than the current limiting
+// magnitude is therefore a prefix of the buffer, so culling is a binary search and the whole
+// visible sky is one GL_POINTS draw. --star-catalog takes a HYG-style CSV (ra in hours, dec in
+// degrees, mag, ci); without one a synthetic sky with realistic star counts is generated.
+static const uint32_t kStarFileVersion = 1;
+static const char* const kGeneratedStarPath = "stars/generated.sst";
+static const int kGeneratedStarCount = 120000;
+static const float kStarMagMin = -2.0f;             // magnitude code 0; codes step 1/16 mag up to ~13.9
+static const float kStarLimitMag = 6.5f;            // naked-eye limit at the default 45 deg FOV
+
+struct StarFileHeader {
+    char magic[4];                               // "SSST"
+    uint32_t version, count, dataOffset;
+    int64_t sourceTime, sourceSize;              // stamp of the CSV it was compiled from, 0 when generated
+    uint32_t reserved[8];
+};
+static_assert(sizeof(StarFileHeader) == 64, "StarFileHeader is part of the file format");
+
+struct StarRecord {
+    int16_t dir[3];                              // snorm16 unit direction in scene axes
+    uint8_t mag;                                 // (magnitude - kStarMagMin) * 16
+    uint8_t bv;                                  // (B-V + 0.5) * 64
+};
+static_assert(sizeof(StarRecord) == 8, "StarRecord is part of the file format");
+
+static StarRecord makeStar(glm::vec3 dir, float mag, float bv) {
+    dir = glm::normalize(dir);
+    StarRecord s;
+    s.dir[0] = snorm16(dir.x); s.dir[1] = snorm16(dir.y); s.dir[2] = snorm16(dir.z);
+    s.mag = (uint8_t)glm::clamp(std::lround((mag - kStarMagMin) * 16.0f), 0L, 255L);
+    s.bv = (uint8_t)glm::clamp(std::lround((bv + 0.5f) * 64.0f), 0L, 255L);
+    return s;
+}
+static float starMagnitude(uint8_t code) { return kStarMagMin + code / 16.0f; }
+
+static bool writeStarFile(const std::string& dst, std::vector<StarRecord>& stars, int64_t srcTime, int64_t srcSize) {
+    std::stable_sort(stars.begin(), stars.end(), [](const StarRecord& a, const StarRecord& b) { return a.mag < b.mag; });
+    StarFileHeader h{};
+    std::memcpy(h.magic, "SSST", 4);
+    h.version = kStarFileVersion; h.count = (uint32_t)stars.size(); h.dataOffset = sizeof(h);
+    h.sourceTime = srcTime; h.sourceSize = srcSize;
+    makeDir("stars");
+    std::ofstream f(dst, std::ios::binary);
+    if (!f) return false;
+    f.write((const char*)&h, sizeof(h));
+    f.write((const char*)stars.data(), (std::streamsize)(stars.size() * sizeof(StarRecord)));
+    return (bool)f;
+}
+
+// counts follow the real sky, N(< m) ~ 10^(0.45 (m - 9)): ~9k to magnitude 6.5, 120k to 9.
+// Half of the stars crowd a band tilted like the Milky Way against the ecliptic.
+static void generateStars(std::vector<StarRecord>& stars) {
+    uint32_t seed = 2024u;
+    auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return ((seed >> 8) + 0.5f) * (1.0f / 16777216.0f); };
+    const glm::vec3 pole = glm::normalize(glm::vec3(-0.868f, 0.497f, 0.0f));     // galactic north in scene axes
+    const glm::vec3 u = glm::normalize(glm::cross(pole, glm::vec3(0, 0, 1))), w = glm::cross(pole, u);
+    stars.resize(kGeneratedStarCount);
+    for (StarRecord& s : stars) {
+        float sinB = rnd() < 0.5f ? 2.0f * rnd() - 1.0f
+                                  : (rnd() < 0.5f ? -1.0f : 1.0f) * std::min(1.0f, -0.15f * std::log(rnd()));
+        float l = glm::two_pi<float>() * rnd(), cosB = std::sqrt(1.0f - sinB * sinB);
+        glm::vec3 d = cosB * (std::cos(l) * u + std::sin(l) * w) + sinB * pole;
+        float mag = 9.0f + std::log10(rnd()) / 0.45f;
+        float bv = glm::clamp(0.6f + 0.4f * (rnd() + rnd() + rnd() - 1.5f) * 2.0f, -0.3f, 2.0f);
+        s = makeStar(d, std::max(mag, -1.5f), bv);
+    }
+}
+
+// header-driven, so any column order works; rows without a magnitude (or the Sun itself) are skipped
+static bool compileStarCatalog(const std::string& src, std::vector<StarRecord>& stars) {
+    TimelineScope ts("compile star catalog " + src);
+    std::ifstream in(src);
+    if (!in) { std::cerr << "Cannot open star catalog " << src << "\n"; return false; }
+    auto split = [](const std::string& line, std::vector<std::string>& out) {
+        out.clear();
+        for (size_t pos = 0;;) {
+            size_t c = line.find(',', pos);
+            std::string f = line.substr(pos, c - pos);
+            if (f.size() >= 2 && f.front() == '"' && f.back() == '"') f = f.substr(1, f.size() - 2);
+            out.push_back(f);
+            if (c == std::string::npos) break;
+            pos = c + 1;
+        }
+    };
+    std::string line;
+    std::vector<std::string> cols;
+    if (!std::getline(in, line)) return false;
+    split(line, cols);
+    int ra = -1, dec = -1, mag = -1, ci = -1;
+    for (int i = 0; i < (int)cols.size(); ++i) {
+        if (cols[i] == "ra") ra = i; else if (cols[i] == "dec") dec = i;
+        else if (cols[i] == "mag") mag = i; else if (cols[i] == "ci") ci = i;
+    }
+    if (ra < 0 || dec < 0 || mag < 0) { std::cerr << src << ": needs ra, dec and mag columns\n"; return false; }
+    const float eps = glm::radians(23.4393f);    // equatorial -> ecliptic, then the scene's (x, z, -y)
+    const float ce = std::cos(eps), se = std::sin(eps);
+    while (std::getline(in, line)) {
+        split(line, cols);
+        if ((int)cols.size() <= std::max(std::max(ra, dec), std::max(mag, ci))) continue;
+        char* end = nullptr;
+        float m = std::strtof(cols[mag].c_str(), &end);
+        if (cols[mag].empty() || *end || m < kStarMagMin) continue;
+        float a = glm::radians(std::strtof(cols[ra].c_str(), nullptr) * 15.0f);
+        float d = glm::radians(std::strtof(cols[dec].c_str(), nullptr));
+        float bv = ci >= 0 && !cols[ci].empty() ? std::strtof(cols[ci].c_str(), nullptr) : 0.6f;
+        float x = std::cos(d) * std::cos(a), y = std::cos(d) * std::sin(a), z = std::sin(d);
+        float ye = y * ce + z * se, ze = -y * se + z * ce;
+        stars.push_back(makeStar(glm::vec3(x, ze, -ye), m, bv));
+    }
+    if (stars.empty()) { std::cerr << src << ": no stars\n"; return false; }
+    return true;
+}
+
+static bool validStarFile(const MappedFile& f, StarFileHeader& h) {
+    if (f.size < sizeof(h)) return false;
+    std::memcpy(&h, f.data, sizeof(h));
+    return std::memcmp(h.magic, "SSST", 4) == 0 && h.version == kStarFileVersion && h.count > 0
+        && (uint64_t)h.dataOffset + (uint64_t)h.count * sizeof(StarRecord) <= f.size;
+}
+
+// worker-side: (re)build dst from the CSV when stale, or generate it when there is no CSV
+static bool ensureStarCatalog(const std::string& src, const std::string& dst) {
+    int64_t t = 0, n = 0;
+    bool haveSrc = !src.empty() && fileStamp(src.c_str(), t, n);
+    if (!src.empty() && !haveSrc) std::cerr << "Cannot open star catalog " << src << "\n";
+    MappedFile f; StarFileHeader h;
+    bool ok = mapFile(dst.c_str(), f) && validStarFile(f, h) && (!haveSrc || (h.sourceTime == t && h.sourceSize == n));
+    unmapFile(f);
+    if (ok) return true;
+    std::vector<StarRecord> stars;
+    if (haveSrc) { if (!compileStarCatalog(src, stars)) return false; }
+    else if (src.empty()) { TimelineScope ts("generate stars"); generateStars(stars); }
+    else return false;
+    return writeStarFile(dst, stars, t, n);
+}
+
+struct StarField {
+    MappedFile file;
+    const StarRecord* stars = nullptr;
+    uint32_t count = 0;
+    GLuint vao = 0, vbo = 0;
+};
+
+static bool starFieldLoad(StarField& sf, const std::string& path) {
+    TimelineScope ts("upload stars");
+    StarFileHeader h;
+    if (!mapFile(path.c_str(), sf.file) || !validStarFile(sf.file, h)) { unmapFile(sf.file); return false; }
+    sf.stars = (const StarRecord*)(sf.file.data + h.dataOffset);
+    sf.count = h.count;
+    glGenVertexArrays(1, &sf.vao); glGenBuffers(1, &sf.vbo);
+    glBindVertexArray(sf.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, sf.vbo);
+    gpuBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sf.count * sizeof(StarRecord), sf.stars, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(StarRecord), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(StarRecord), (void*)offsetof(StarRecord, mag));
+    glBindVertexArray(0);
+    return true;
+}
+
+// stars at or brighter than limitMag: a prefix, since the records are sorted by magnitude
+static uint32_t starsBrighterThan(const StarField& sf, float limitMag) {
+    const StarRecord* end = std::upper_bound(sf.stars, sf.stars + sf.count, limitMag,
+                                             [](float m, const StarRecord& s) { return m < starMagnitude(s.mag); });
+    return (uint32_t)(end - sf.stars);
+}
+
+// ===================== FRAME CAPTURE =====================
+// Records the back buffer to captures/capture_NNN.y4m. Every frame's glReadPixels lands in the
+// next PBO of a small ring behind a fence, and a slot is only mapped once its fence has signalled,
+// so neither the readback nor glfwSwapBuffers waits on the GPU. Mapped frames are copied out and
+// handed to an encoder thread that converts them to 4:2:0 and appends them to the file.
+// The file plays at a fixed kCaptureFps whatever the loop presents at (vsync, a cap, the paused cap,
+// uncapped): each frame is written once per clock tick it covers, and frames between ticks are skipped.
+static const int kCaptureRing = 4;
+static const int kCaptureMaxQueued = 8;          // frames waiting on the encoder before we drop
+static const int kCaptureFps = 60;
+
+class FrameEncoder {
+public:
+    ~FrameEncoder() { close(); }
+    bool open(const std::string& path, int width, int height) {
+        out.open(path, std::ios::binary);
+        if (!out) return false;
+        w = width; h = height; closing = false; written = 0;
+        out << "YUV4MPEG2 W" << w << " H" << h << " F" << kCaptureFps << ":1 Ip A1:1 C420jpeg\n";
+        worker = std::thread([this] { run(); });
+        return true;
+    }
+    // the frame is written `repeat` times; false when the encoder is behind and the caller counts it as dropped
+    bool push(std::vector<unsigned char>&& rgba, int repeat) {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            if ((int)q.size() >= kCaptureMaxQueued) return false;
+            q.emplace_back(std::move(rgba), repeat);
+        }
+        cv.notify_one(); return true;
+    }
+    // encodes whatever is still queued, then closes the file
+    void close() {
+        if (!worker.joinable()) return;
+        { std::lock_guard<std::mutex> lk(m); closing = true; }
+        cv.notify_one(); worker.join(); out.close();
+    }
+    std::atomic<int> written{ 0 };
+private:
+    void run() {
+        std::vector<unsigned char> planes((size_t)w * h * 3 / 2);
+        for (;;) {
+            std::vector<unsigned char> rgba; int repeat;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [this] { return closing || !q.empty(); });
+                if (q.empty()) return;
+                rgba = std::move(q.front().first); repeat = q.front().second; q.pop_front();
+            }
+            toYuv420(rgba.data(), planes.data());
+            for (int i = 0; i < repeat; ++i) {
+                out << "FRAME\n";
+                out.write((const char*)planes.data(), planes.size());
+                written++;
+            }
+        }
+    }
+    // BT.601 studio range; GL rows are bottom-up, Y4M is top-down
+    void toYuv420(const unsigned char* rgba, unsigned char* dst) const {
+        unsigned char* Y = dst; unsigned char* U = dst + (size_t)w * h; unsigned char* V = U + (size_t)(w / 2) * (h / 2);
+        for (int y = 0; y < h; y += 2)
+            for (int x = 0; x < w; x += 2) {
+                int r = 0, g = 0, b = 0;
+                for (int k = 0; k < 4; ++k) {
+                    int sy = y + (k >> 1), sx = x + (k & 1);
+                    const unsigned char* p = rgba + ((size_t)(h - 1 - sy) * w + sx) * 4;
+                    Y[(size_t)sy * w + sx] = (unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+                    r += p[0]; g += p[1]; b += p[2];
+                }
+                r /= 4; g /= 4; b /= 4;
+                U[(size_t)(y / 2) * (w / 2) + x / 2] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                V[(size_t)(y / 2) * (w / 2) + x / 2] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+    }
+    std::ofstream out; int w = 0, h = 0;
+    std::thread worker; std::mutex m; std::condition_variable cv;
+    std::deque<std::pair<std::vector<unsigned char>, int>> q; bool closing = false;
+};
+
+struct FrameCapture {
+    GLuint pbo[kCaptureRing] = {}; GLsync fence[kCaptureRing] = {};
+    int repeat[kCaptureRing] = {};                // clock ticks each readback stands for
+    int head = 0, tail = 0, inFlight = 0, w = 0, h = 0;
+    double start = 0.0; int64_t ticks = 0;       // capture clock: ticks already handed a frame
+    int carry = 0;                               // ticks of dropped frames, written with the next one
+    bool active = false; int dropped = 0;
+    std::string path; FrameEncoder enc;
+};
+
+// consume finished readbacks in order; wait=true blocks (only used when stopping)
+static void captureDrain(FrameCapture& fc, bool wait) {
+    while (fc.inFlight > 0) {
+        GLsync& f = fc.fence[fc.tail];
+        GLenum st = glClientWaitSync(f, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+        if (st != GL_ALREADY_SIGNALED && st != GL_CONDITION_SATISFIED) return;
+        glDeleteSync(f); f = nullptr;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, fc.pbo[fc.tail]);
+        size_t bytes = (size_t)fc.w * fc.h * 4;
+        if (const unsigned char* src = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+            std::vector<unsigned char> frame(src, src + bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            int n = fc.repeat[fc.tail] + fc.carry;
+            if (fc.enc.push(std::move(frame), n)) fc.carry = 0;
+            else { fc.carry = n; fc.dropped++; }
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fc.tail = (fc.tail + 1) % kCaptureRing; fc.inFlight--;
+    }
+}
+static bool captureStart(FrameCapture& fc, int w, int h) {
+    fc.w = w & ~1; fc.h = h & ~1;                  // 4:2:0 needs even dimensions
+    makeDir("captures");
+    for (int i = 0;; ++i) {
+        char name[64]; std::snprintf(name, sizeof(name), "captures/capture_%03d.y4m", i);
+        if (!std::ifstream(name)) { fc.path = name; break; }
+    }
+    if (!fc.enc.open(fc.path, fc.w, fc.h)) { std::cerr << "\nCapture: cannot write " << fc.path << "\n"; return false; }
+    if (!fc.pbo[0]) glGenBuffers(kCaptureRing, fc.pbo);
+    for (GLuint b : fc.pbo) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, b);
+        gpuBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)fc.w * fc.h * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fc.head = fc.tail = fc.inFlight = 0; fc.dropped = 0; fc.active = true;
+    fc.start = glfwGetTime(); fc.ticks = 0; fc.carry = 0;
+    std::cout << "\nRecording to " << fc.path << "\n";
+    return true;
+}
+static void captureStop(FrameCapture& fc) {
+    if (!fc.active) return;
+    captureDrain(fc, true);
+    fc.enc.close(); fc.active = false;
+    std::cout << "\nSaved " << fc.enc.written << " frames to " << fc.path << " (" << fc.dropped << " dropped)\n";
+}
+// after the frame is drawn, before the swap
+static void captureFrame(FrameCapture& fc, int w, int h) {
+    if ((w & ~1) != fc.w || (h & ~1) != fc.h) { std::cout << "\nWindow resized, stopping capture"; captureStop(fc); return; }
+    captureDrain(fc, false);
+    int64_t due = (int64_t)((glfwGetTime() - fc.start) * kCaptureFps) + 1;
+    if (due <= fc.ticks) return;                              // faster than the capture clock
+    if (fc.inFlight == kCaptureRing) { fc.dropped++; return; } // GPU is a whole ring behind; the next frame covers its ticks
+    fc.repeat[fc.head] = (int)(due - fc.ticks); fc.ticks = due;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, fc.pbo[fc.head]);
+    glReadBuffer(GL_BACK);
+    glReadPixels(0, 0, fc.w, fc.h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fc.fence[fc.head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fc.head = (fc.head + 1) % kCaptureRing; fc.inFlight++;
+}
+
+// ===================== SCENE FILES =====================
+// scenes/<name>.scene is the editable description; the first run compiles it to <name>.ssc beside it:
+// SceneFileHeader | SceneBodyRecord[] | SceneRingRecord[] | SceneLightRecord[] | string table. The compiled file is mapped
+// and read in place, so a load is one pass over fixed-size records with no text to parse.
+static const uint32_t kSceneFileVersion = 3;
+static const uint32_t kSceneNoString = 0xFFFFFFFFu;
+enum SceneBodyFlags : uint32_t { SB_VIRTUAL_TEXTURE = 1, SB_NO_ORBIT_LINE = 2 };
+
+struct SceneFileHeader {
+    char magic[4];                          // "SSSC"
+    uint32_t version, bodyCount, ringCount, skyTexture;
+    uint32_t bodyOffset, ringOffset, stringOffset, stringBytes;
+    uint32_t lightCount;
+    int64_t sourceTime, sourceSize;         // stamp of the .scene it was compiled from
+    uint32_t lightOffset, reserved;
+};
+static_assert(sizeof(SceneFileHeader) == 64, "SceneFileHeader is part of the file format");
+
+struct SceneBodyRecord {
+    uint32_t name, texture;                 // string table offsets (texture may be kSceneNoString)
+    int32_t parent;                         // index of an earlier record, -1 for a root
+    uint32_t flags;                         // SceneBodyFlags
+    float radius, orbitRadius, orbitSpeed, spinSpeed, orbitAngle, spinAngle;
+    float shininess, ks, base[3], emissive[3];
+    float eccentricity;                     // orbitRadius is the semi-major axis
+    uint32_t reserved;
+};
+static_assert(sizeof(SceneBodyRecord) == 80, "SceneBodyRecord is part of the file format");
+
+struct SceneRingRecord {
+    int32_t parent; uint32_t texture;
+    float inner, outer, tilt, shininess, ks;
+    uint32_t reserved;
+};
+static_assert(sizeof(SceneRingRecord) == 32, "SceneRingRecord is part of the file format");
+
+// a point light riding on a body; the first one in the file is the primary (eclipses, the lit uniforms)
+struct SceneLightRecord {
+    int32_t parent;
+    float offset[3], color[3];
+    float range;                            // 0: unattenuated, reaches everything
+};
+static_assert(sizeof(SceneLightRecord) == 32, "SceneLightRecord is part of the file format");
+
+// a mapped .ssc (or, when it could not be written, the compiled bytes in memory); the record pointers stay
+// valid while the mapping or bytes are held
+struct Scene {
+    MappedFile file;
+    std::vector<unsigned char> bytes;
+    const SceneFileHeader* h = nullptr;
+    const SceneBodyRecord* bodies = nullptr;
+    const SceneRingRecord* rings = nullptr;
+    const SceneLightRecord* lights = nullptr;
+    const char* strings = nullptr;
+    const char* str(uint32_t off) const { return off == kSceneNoString ? "" : strings + off; }
+};
+
+// "x" or "x,y,z"; a single value fills every component
+static bool sceneFloats(const std::string& v, float* out, int n) {
+    std::vector<std::string> parts;
+    for (size_t pos = 0;;) {
+        size_t c = v.find(',', pos);
+        parts.push_back(v.substr(pos, c - pos));
+        if (c == std::string::npos) break;
+        pos = c + 1;
+    }
+    if (parts.size() != 1 && parts.size() != (size_t)n) return false;
+    for (int i = 0; i < n; ++i) {
+        const std::string& p = parts[parts.size() == 1 ? 0 : i];
+        char* end = nullptr;
+        out[i] = std::strtof(p.c_str(), &end);
+        if (p.empty() || *end) return false;
+    }
+    return true;
+}
+
+static bool compileScene(const std::string& src, int64_t srcTime, int64_t srcSize, std::vector<unsigned char>& out) {
+    TimelineScope ts("compile scene " + src);
+    std::ifstream in(src);
+    if (!in) return false;
+    std::vector<SceneBodyRecord> bodies;
+    std::vector<SceneRingRecord> rings;
+    std::vector<SceneLightRecord> lights;
+    std::unordered_map<std::string, int> bodyIndex;
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> stringIndex;
+    auto intern = [&](const std::string& s) {
+        auto it = stringIndex.find(s);
+        if (it != stringIndex.end()) return it->second;
+        uint32_t off = (uint32_t)strings.size();
+        strings.append(s).push_back('\0');
+        stringIndex.emplace(s, off);
+        return off;
+    };
+    uint32_t sky = kSceneNoString;
+    std::string line;
+    int lineNo = 0;
+    auto fail = [&](const std::string& msg) { std::cerr << src << ":" << lineNo << ": " << msg << "\n"; return false; };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string kind, name, tok;
+        if (!(ss >> kind)) continue;
+        if (!(ss >> name)) return fail(kind + " needs a name");
+        std::vector<std::pair<std::string, std::string>> fields;
+        while (ss >> tok) {
+            size_t eq = tok.find('=');
+            if (eq == std::string::npos || eq == 0) return fail("expected key=value, got " + tok);
+            fields.emplace_back(tok.substr(0, eq), tok.substr(eq + 1));
+        }
+
+        if (kind == "sky") {
+            if (!fields.empty()) return fail("sky takes only a texture path");
+            sky = intern(name);
+        }
+        else if (kind == "body") {
+            if (bodyIndex.count(name)) return fail("duplicate body " + name);
+            SceneBodyRecord b{};
+            b.name = intern(name); b.texture = kSceneNoString; b.parent = -1;
+            b.radius = 1.0f; b.shininess = 32.0f; b.ks = 0.25f;
+            b.base[0] = b.base[1] = b.base[2] = 1.0f;
+            for (const auto& kv : fields) {
+                const std::string& k = kv.first;
+                const std::string& v = kv.second;
+                float* f = k == "radius" ? &b.radius : k == "orbit" ? &b.orbitRadius : k == "orbitSpeed" ? &b.orbitSpeed
+                         : k == "spin" ? &b.spinSpeed : k == "angle" ? &b.orbitAngle : k == "spinAngle" ? &b.spinAngle
+                         : k == "shininess" ? &b.shininess : k == "ks" ? &b.ks : k == "ecc" ? &b.eccentricity : nullptr;
+                bool ok = true;
+                if (f) ok = sceneFloats(v, f, 1);
+                else if (k == "base") ok = sceneFloats(v, b.base, 3);
+                else if (k == "emissive") ok = sceneFloats(v, b.emissive, 3);
+                else if (k == "texture") b.texture = intern(v);
+                else if (k == "vt") b.flags = v == "0" ? b.flags & ~SB_VIRTUAL_TEXTURE : b.flags | SB_VIRTUAL_TEXTURE;
+                else if (k == "orbitLine") b.flags = v == "0" ? b.flags | SB_NO_ORBIT_LINE : b.flags & ~SB_NO_ORBIT_LINE;
+                else if (k == "parent") {
+                    auto it = bodyIndex.find(v);
+                    if (it == bodyIndex.end()) return fail("parent " + v + " must be declared before " + name);
+                    b.parent = it->second;
+                }
+                else return fail("unknown body field " + k);
+                if (!ok) return fail("bad value for " + k + ": " + v);
+            }
+            if (b.radius <= 0.0f) return fail("radius must be positive");
+            if (b.eccentricity < 0.0f || b.eccentricity >= 0.95f) return fail("ecc must be in [0, 0.95)");
+            bodyIndex.emplace(name, (int)bodies.size());
+            bodies.push_back(b);
+        }
+        else if (kind == "ring") {
+            auto it = bodyIndex.find(name);
+            if (it == bodyIndex.end()) return fail("ring parent " + name + " must be declared first");
+            SceneRingRecord r{};
+            r.parent = it->second; r.texture = kSceneNoString;
+            r.inner = 1.0f; r.outer = 2.0f; r.shininess = 8.0f; r.ks = 0.05f;
+            for (const auto& kv : fields) {
+                const std::string& k = kv.first;
+                const std::string& v = kv.second;
+                float* f = k == "inner" ? &r.inner : k == "outer" ? &r.outer : k == "tilt" ? &r.tilt
+                         : k == "shininess" ? &r.shininess : k == "ks" ? &r.ks : nullptr;
+                if (k == "texture") r.texture = intern(v);
+                else if (!f) return fail("unknown ring field " + k);
+                else if (!sceneFloats(v, f, 1)) return fail("bad value for " + k + ": " + v);
+            }
+            if (r.inner < 0.0f || r.outer <= r.inner) return fail("ring needs 0 <= inner < outer");
+            rings.push_back(r);
+        }
+        else if (kind == "light") {
+            auto it = bodyIndex.find(name);
+            if (it == bodyIndex.end()) return fail("light parent " + name + " must be declared first");
+            SceneLightRecord l{};
+            l.parent = it->second;
+            l.color[0] = l.color[1] = l.color[2] = 1.0f;
+            for (const auto& kv : fields) {
+                const std::string& k = kv.first;
+                const std::string& v = kv.second;
+                float* f = k == "color" ? l.color : k == "offset" ? l.offset : k == "range" ? &l.range : nullptr;
+                if (!f) return fail("unknown light field " + k);
+                if (!sceneFloats(v, f, k == "range" ? 1 : 3)) return fail("bad value for " + k + ": " + v);
+            }
+            if (l.range < 0.0f) return fail("light range must be >= 0");
+            lights.push_back(l);
+        }
+        else return fail("unknown directive " + kind);
+    }
+    if (bodies.empty()) return fail("scene has no bodies");
+
+    SceneFileHeader h{};
+    std::memcpy(h.magic, "SSSC", 4);
+    h.version = kSceneFileVersion;
+    h.bodyCount = (uint32_t)bodies.size(); h.ringCount = (uint32_t)rings.size(); h.skyTexture = sky;
+    h.bodyOffset = sizeof(h);
+    h.ringOffset = h.bodyOffset + h.bodyCount * (uint32_t)sizeof(SceneBodyRecord);
+    h.lightCount = (uint32_t)lights.size();
+    h.lightOffset = h.ringOffset + h.ringCount * (uint32_t)sizeof(SceneRingRecord);
+    h.stringOffset = h.lightOffset + h.lightCount * (uint32_t)sizeof(SceneLightRecord);
+    h.stringBytes = (uint32_t)strings.size();
+    h.sourceTime = srcTime; h.sourceSize = srcSize;
+    out.resize(h.stringOffset + strings.size());
+    auto put = [&](uint32_t off, const void* p, size_t n) { if (n) std::memcpy(&out[off], p, n); };
+    put(0, &h, sizeof(h));
+    put(h.bodyOffset, bodies.data(), bodies.size() * sizeof(SceneBodyRecord));
+    put(h.ringOffset, rings.data(), rings.size() * sizeof(SceneRingRecord));
+    put(h.lightOffset, lights.data(), lights.size() * sizeof(SceneLightRecord));
+    put(h.stringOffset, strings.data(), strings.size());
+    return true;
+}
+
+// bounds, string offsets and parent order are checked once here so the renderer can trust every record
+static bool bindScene(Scene& s, const unsigned char* data, uint64_t size) {
+    const SceneFileHeader* h = (const SceneFileHeader*)data;
+    bool ok = size >= sizeof(*h) && std::memcmp(h->magic, "SSSC", 4) == 0 && h->version == kSceneFileVersion
+        && h->bodyCount > 0 && h->bodyOffset % 4 == 0 && h->ringOffset % 4 == 0
+        && (uint64_t)h->bodyOffset + (uint64_t)h->bodyCount * sizeof(SceneBodyRecord) <= size
+        && (uint64_t)h->ringOffset + (uint64_t)h->ringCount * sizeof(SceneRingRecord) <= size
+        && h->lightOffset % 4 == 0 && (uint64_t)h->lightOffset + (uint64_t)h->lightCount * sizeof(SceneLightRecord) <= size
+        && (uint64_t)h->stringOffset + h->stringBytes <= size
+        && (h->stringBytes == 0 || data[h->stringOffset + h->stringBytes - 1] == '\0');
+    if (ok) {
+        s.h = h;
+        s.bodies = (const SceneBodyRecord*)(data + h->bodyOffset);
+        s.rings = (const SceneRingRecord*)(data + h->ringOffset);
+        s.lights = (const SceneLightRecord*)(data + h->lightOffset);
+        s.strings = (const char*)data + h->stringOffset;
+        auto strOk = [&](uint32_t off) { return off == kSceneNoString || off < h->stringBytes; };
+        ok = strOk(h->skyTexture);
+        for (uint32_t i = 0; ok && i < h->bodyCount; ++i)
+            ok = strOk(s.bodies[i].name) && strOk(s.bodies[i].texture) && s.bodies[i].parent < (int32_t)i && s.bodies[i].parent >= -1;
+        for (uint32_t i = 0; ok && i < h->ringCount; ++i)
+            ok = strOk(s.rings[i].texture) && s.rings[i].parent >= 0 && s.rings[i].parent < (int32_t)h->bodyCount;
+        for (uint32_t i = 0; ok && i < h->lightCount; ++i)
+            ok = s.lights[i].parent >= 0 && s.lights[i].parent < (int32_t)h->bodyCount && s.lights[i].range >= 0.0f;
+    }
+    return ok;
+}
+
+static bool mapScene(const std::string& path, Scene& s) {
+    if (!mapFile(path.c_str(), s.file)) return false;
+    if (bindScene(s, s.file.data, s.file.size)) return true;
+    unmapFile(s.file); s = Scene{};
+    return false;
+}
+
+// a .ssc path is used as given; a .scene source is (re)compiled when its .ssc is missing, stale or
+// from another build. A scene directory that cannot be written costs only the compile on every run.
+static bool loadScene(const std::string& path, Scene& s) {
+    TimelineScope ts("load scene");
+    size_t slash = path.find_last_of("/\\"), dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = path.size();
+    if (path.compare(dot, std::string::npos, ".ssc") == 0) {
+        if (mapScene(path, s)) return true;
+        std::cerr << "Cannot load compiled scene " << path << "\n";
+        return false;
+    }
+    int64_t t = 0, n = 0;
+    if (!fileStamp(path.c_str(), t, n)) { std::cerr << "Cannot open scene " << path << "\n"; return false; }
+    std::string dst = path.substr(0, dot) + ".ssc";
+    if (mapScene(dst, s)) {
+        if (s.h->sourceTime == t && s.h->sourceSize == n) return true;
+        unmapFile(s.file); s = Scene{};
+    }
+    std::vector<unsigned char> image;
+    if (!compileScene(path, t, n, image)) { std::cerr << "Cannot compile scene " << path << "\n"; return false; }
+    std::ofstream f(dst, std::ios::binary);
+    if (f) f.write((const char*)image.data(), (std::streamsize)image.size());
+    f.close();
+    if (!f || !mapScene(dst, s)) {
+        std::cerr << "Scene cache write failed: " << dst << " (using the compiled scene from memory)\n";
+        s = Scene{};
+        s.bytes.swap(image);
+        if (!bindScene(s, s.bytes.data(), s.bytes.size())) { std::cerr << "Cannot compile scene " << path << "\n"; return false; }
+        dst = "memory";
+    }
+    std::cout << "Compiled " << path << " -> " << dst << " (" << s.h->bodyCount << " bodies, "
+              << s.h->ringCount << " rings, " << s.h->lightCount << " lights)\n";
+    return true;
+}
+
+// ===================== EPHEMERIS =====================
+// --ephemeris places the planets from Chebyshev segments (JPL DE-style) instead of circular orbits.
+// ephemeris/planets.sse: EphemFileHeader | EphemBodyRecord[] | segment blocks, 64-byte aligned.
+// All bodies share one segment length, so finding a date's segment is a divide, and a frame reads
+// one contiguous block laid out for chebEvalSegment. The file is fitted from the mean elements in
+// solar_core.h on first use; any file in this layout can replace it.
+static const uint32_t kEphemFileVersion = 1;
+static const char* kEphemPath = "ephemeris/planets.sse";
+static const int kEphemCoeffs = 12;
+static const double kEphemSegmentDays = 16.0;                           // 12 terms hold Mercury to ~0.1 km
+static const double kEphemStartJd = 2433282.5, kEphemEndJd = 2469807.5; // 1950-01-01 .. 2050-01-01
+static const double kEphemDaysPerSecond = 10.0;                         // simulated days per second at timeScale 1
+
+struct EphemFileHeader {
+    char magic[4];                          // "SSEP"
+    uint32_t version, bodyCount, bodyStride, coeffCount, segmentCount;
+    double startJd, segmentDays;
+    uint32_t bodyOffset, dataOffset;
+    uint32_t reserved[4];
+};
+static_assert(sizeof(EphemFileHeader) == 64, "EphemFileHeader is part of the file format");
+struct EphemBodyRecord { char name[16]; double a; double reserved; };  // a: mean distance in AU
+static_assert(sizeof(EphemBodyRecord) == 32, "EphemBodyRecord is part of the file format");
+
+struct Ephemeris {
+    MappedFile file;
+    const EphemFileHeader* h = nullptr;
+    const EphemBodyRecord* bodies = nullptr;
+    const double* data = nullptr;
+    std::vector<double> x, y, z;            // last evaluation: heliocentric ecliptic AU, bodyStride entries
+};
+
+static size_t ephemBlockDoubles(const EphemFileHeader& h) { return (size_t)3 * h.coeffCount * h.bodyStride; }
+
+static bool bakeEphemeris(const std::string& path) {
+    TimelineScope ts("fit ephemeris");
+    EphemFileHeader h{};
+    std::memcpy(h.magic, "SSEP", 4);
+    h.version = kEphemFileVersion;
+    h.bodyCount = kPlanetCount; h.bodyStride = alignUp(h.bodyCount, 4); h.coeffCount = kEphemCoeffs;
+    h.segmentCount = (uint32_t)std::ceil((kEphemEndJd - kEphemStartJd) / kEphemSegmentDays);
+    h.startJd = kEphemStartJd; h.segmentDays = kEphemSegmentDays;
+    h.bodyOffset = sizeof(h);
+    h.dataOffset = alignUp(h.bodyOffset + h.bodyCount * (uint32_t)sizeof(EphemBodyRecord), 64);
+    std::vector<EphemBodyRecord> recs(h.bodyCount);
+    for (int b = 0; b < kPlanetCount; ++b) {
+        std::snprintf(recs[b].name, sizeof(recs[b].name), "%s", kPlanetElements[b].name);
+        recs[b].a = kPlanetElements[b].a;
+    }
+    makeDir("ephemeris");
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    static const char zeros[64] = {};
+    f.write((const char*)&h, sizeof(h));
+    f.write((const char*)recs.data(), (std::streamsize)(recs.size() * sizeof(EphemBodyRecord)));
+    f.write(zeros, h.dataOffset - (h.bodyOffset + h.bodyCount * sizeof(EphemBodyRecord)));
+    std::vector<double> block(ephemBlockDoubles(h));
+    double coeffs[kEphemCoeffs];
+    for (uint32_t s = 0; s < h.segmentCount; ++s) {
+        double t0 = h.startJd + s * h.segmentDays, t1 = t0 + h.segmentDays;
+        for (int b = 0; b < kPlanetCount; ++b)
+            for (int c = 0; c < 3; ++c) {
+                chebFit([&](double jd) { double p[3]; keplerPosition(kPlanetElements[b], jd, p); return p[c]; },
+                        t0, t1, kEphemCoeffs, coeffs);
+                for (int k = 0; k < kEphemCoeffs; ++k) block[((size_t)c * kEphemCoeffs + k) * h.bodyStride + b] = coeffs[k];
+            }
+        f.write((const char*)block.data(), (std::streamsize)(block.size() * sizeof(double)));
+    }
+    return (bool)f;
+}
+
+static bool mapEphemeris(const std::string& path, Ephemeris& e) {
+    if (!mapFile(path.c_str(), e.file)) return false;
+    const EphemFileHeader* h = (const EphemFileHeader*)e.file.data;
+    bool ok = e.file.size >= sizeof(*h) && std::memcmp(h->magic, "SSEP", 4) == 0 && h->version == kEphemFileVersion
+        && h->bodyCount > 0 && h->bodyStride >= h->bodyCount && h->coeffCount >= 2 && h->coeffCount <= (uint32_t)kChebMaxCoeffs
+        && h->segmentCount > 0 && h->segmentDays > 0.0 && h->bodyOffset % 8 == 0 && h->dataOffset % 8 == 0
+        && (uint64_t)h->bodyOffset + (uint64_t)h->bodyCount * sizeof(EphemBodyRecord) <= e.file.size
+        && (uint64_t)h->dataOffset + (uint64_t)h->segmentCount * ephemBlockDoubles(*h) * sizeof(double) <= e.file.size;
+    if (!ok) { unmapFile(e.file); return false; }
+    e.h = h;
+    e.bodies = (const EphemBodyRecord*)(e.file.data + h->bodyOffset);
+    e.data = (const double*)(e.file.data + h->dataOffset);
+    e.x.assign(h->bodyStride, 0.0); e.y.assign(h->bodyStride, 0.0); e.z.assign(h->bodyStride, 0.0);
+    return true;
+}
+
+// worker-side: make sure the ephemeris file exists and matches this build
+static bool ensureEphemeris(const std::string& path) {
+    Ephemeris e;
+    bool ok = mapEphemeris(path, e);
+    unmapFile(e.file);
+    return ok || bakeEphemeris(path);
+}
+
+static const KeplerElements* planetElements(const char* name) {
+    for (const KeplerElements& k : kPlanetElements)
+        if (std::strcmp(k.name, name) == 0) return &k;
+    return nullptr;
+}
+static int ephemerisBody(const Ephemeris& e, const char* name) {
+    for (uint32_t i = 0; i < e.h->bodyCount; ++i)
+        if (std::strncmp(e.bodies[i].name, name, sizeof(e.bodies[i].name)) == 0) return (int)i;
+    return -1;
+}
+
+// every body at Julian date jd, clamped to the span the file covers
+static void ephemerisEval(Ephemeris& e, double jd) {
+    const EphemFileHeader& h = *e.h;
+    double s = std::max(0.0, (jd - h.startJd) / h.segmentDays);
+    uint32_t seg = (uint32_t)std::min(s, (double)(h.segmentCount - 1));
+    double tau = std::min(1.0, 2.0 * (s - seg) - 1.0);
+    chebEvalSegment(e.data + seg * ephemBlockDoubles(h), (int)h.coeffCount, (int)h.bodyStride, tau,
+                    e.x.data(), e.y.data(), e.z.data());
+}
+
+// ecliptic (z = north) to scene space (y = up); the same handedness the circular orbits use
+static glm::vec3 eclipticToScene(double x, double y, double z, float scale) {
+    return glm::vec3((float)x, (float)z, (float)-y) * scale;
+}
+
+static double julianDate(int y, int m, int d) {
+    int a = (14 - m) / 12, yy = y + 4800 - a, mm = m + 12 * a - 3;
+    long jdn = d + (153 * mm + 2) / 5 + 365L * yy + yy / 4 - yy / 100 + yy / 400 - 32045;
+    return jdn - 0.5;                       // midnight UT
+}
+static double julianDateNow() { return (double)std::time(nullptr) / 86400.0 + 2440587.5; }
+static std::string calendarDate(double jd) {
+    long a = (long)std::floor(jd + 0.5) + 32044;
+    long b = (4 * a + 3) / 146097, c = a - 146097 * b / 4;
+    long d = (4 * c + 3) / 1461, e = c - 1461 * d / 4, m = (5 * e + 2) / 153;
+    int year = (int)(100 * b + d - 4800 + m / 10), month = (int)(m + 3 - 12 * (m / 10)), day = (int)(e - (153 * m + 2) / 5 + 1);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", year, month, day);
+    return buf;
+}
+
+// orbit guide for an ephemeris planet: one period of its Keplerian ellipse from jd, in scene units
+static Mesh ephemerisOrbitLine(const KeplerElements& k, double jd, float scale) {
+    const int segments = 256;
+    double period = 365.25 * std::pow(k.a, 1.5);
+    std::vector<glm::vec3> p(segments);
+    std::vector<unsigned int> idx((size_t)segments * 2);
+    for (int i = 0; i < segments; ++i) {
+        double q[3];
+        keplerPosition(k, jd + period * i / segments, q);
+        p[i] = eclipticToScene(q[0], q[1], q[2], scale);
+        idx[i * 2] = i; idx[i * 2 + 1] = (i + 1) % segments;
+    }
+    std::vector<unsigned char> ibytes;
+    GLenum type = packIndices(idx, p.size(), ibytes);
+    return uploadMesh(VF_POS, p.data(), p.size(), ibytes.data(), (int)idx.size(), type);
+}
+
+// ===================== PLANET =====================
+struct Material { glm::vec3 base{ 1.0f }, emissive{ 0.0f }; float shininess = 32.0f, ks = 0.25f; };
+struct Planet {
+    Mesh mesh; GLuint tex = 0;
+    float orbitRadius = 0, orbitSpeed = 0, spinSpeed = 0;
+    float orbitAngle = 0, spinAngle = 0;
+    int vt = -1;                            // virtual texture index, -1 = plain tex
+    int parent = -1;                        // index of the body it orbits, -1 = fixed at the origin
+    int ephem = -1; float ephemScale = 1;   // ephemeris row (-1 = Keplerian orbit), AU -> scene units
+    float eccentricity = 0;                 // orbitRadius is the semi-major axis, orbitAngle the true anomaly
+    Material mat;
+};
+struct Ring { Mesh mesh; GLuint tex = 0; int parent = 0; float tilt = 0, outer = 0; Material mat; };
+
+// one simulation step of adv seconds (already scaled by timeScale); the ephemeris date runs alongside.
+// Returns the largest orbit substep budget used.
+static int simulate(std::vector<Planet>& bodies, double& ephemJd, float adv) {
+    for (Planet& b : bodies) b.spinAngle = std::fmod(b.spinAngle + b.spinSpeed * adv, 360.0f);
+    ephemJd += adv * kEphemDaysPerSecond;
+    return advanceOrbits(bodies, adv);               // roots only spin: their orbitSpeed is 0
+}
+
+// ===================== SIMULATION TIMELINE =====================
+// Checkpoints of the simulation state (body angles + ephemeris date) taken every `interval`
+// simulated seconds. Seeking restores the newest checkpoint at or before the target and
+// fast-forwards from there, so a scrub re-simulates at most one interval in either direction.
+// Capacity is fixed: when it fills, every other checkpoint is dropped and the interval doubles,
+// so the whole session stays seekable however long it runs.
+static const int kTimelineCapacity = 1024;
+static const double kTimelineInterval = 2.0;        // starting spacing, simulated seconds
+static const double kSeekStep = 0.25;               // fast-forward step, simulated seconds
+static const double kSeekJump = 5.0;                // Left/Right, scaled by timeScale (x10 with Shift)
+
+struct Timeline {
+    double t = 0.0;                                 // simulated seconds since start
+    double interval = kTimelineInterval, next = 0.0;
+    size_t stride = 0;                              // floats per checkpoint: orbit + spin angle per body
+    std::vector<double> times, dates;               // per checkpoint
+    std::vector<float> angles;                      // checkpoint-major, stride floats each
+    int seeks = 0; double seekMs = 0.0;             // last seek cost, for the stats line
+};
+
+// call after every simulation step; stores a checkpoint when one is due
+static void timelineRecord(Timeline& tl, const std::vector<Planet>& bodies, double jd) {
+    if (tl.t < tl.next) return;
+    if ((int)tl.times.size() == kTimelineCapacity) {
+        size_t keep = 0;
+        for (size_t i = 0; i < tl.times.size(); i += 2, ++keep) {
+            tl.times[keep] = tl.times[i]; tl.dates[keep] = tl.dates[i];
+            std::copy_n(tl.angles.begin() + i * tl.stride, tl.stride, tl.angles.begin() + keep * tl.stride);
+        }
+        tl.times.resize(keep); tl.dates.resize(keep); tl.angles.resize(keep * tl.stride);
+        tl.interval *= 2.0;
+    }
+    tl.times.push_back(tl.t); tl.dates.push_back(jd);
+    for (const Planet& b : bodies) { tl.angles.push_back(b.orbitAngle); tl.angles.push_back(b.spinAngle); }
+    tl.next = tl.t + tl.interval;
+}
+
+// bodies and jd are the state at t = 0; it is the first checkpoint, so Home can always get back to it
+static void timelineReset(Timeline& tl, const std::vector<Planet>& bodies, double jd) {
+    tl.t = 0.0; tl.interval = kTimelineInterval; tl.next = 0.0; tl.stride = bodies.size() * 2;
+    tl.times.clear(); tl.dates.clear(); tl.angles.clear();
+    tl.times.reserve(kTimelineCapacity); tl.dates.reserve(kTimelineCapacity);
+    tl.angles.reserve(kTimelineCapacity * tl.stride);
+    timelineRecord(tl, bodies, jd);
+}
+
+static void timelineSeek(Timeline& tl, std::vector<Planet>& bodies, double& jd, double target) {
+    auto t0 = std::chrono::steady_clock::now();
+    target = std::max(0.0, target);
+    if (target < tl.t && !tl.times.empty()) {
+        size_t k = std::upper_bound(tl.times.begin(), tl.times.end(), target) - tl.times.begin();
+        k = k ? k - 1 : 0;
+        const float* a = tl.angles.data() + k * tl.stride;
+        for (Planet& b : bodies) { b.orbitAngle = *a++; b.spinAngle = *a++; }
+        tl.t = tl.times[k]; jd = tl.dates[k];
+        // later checkpoints belong to the abandoned future; they are recorded again on the way forward
+        tl.times.resize(k + 1); tl.dates.resize(k + 1); tl.angles.resize((k + 1) * tl.stride);
+        tl.next = tl.t + tl.interval;
+    }
+    while (tl.t < target) {
+        double step = std::min(kSeekStep, target - tl.t);
+        simulate(bodies, jd, (float)step);
+        tl.t += step;
+        timelineRecord(tl, bodies, jd);
+    }
+    ++tl.seeks;
+    tl.seekMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// ===================== ECLIPSES =====================
+// Sphere-sphere shadowing without a shadow map. The CPU picks, per receiver (body or ring), up
+// to kMaxOccluders bodies whose penumbra can reach it; the lit shader then integrates how much
+// of the Sun's disc each one hides (sunVisibility in fsSrc). Seen from the light, an occluder
+// at distance d with radius r never casts penumbra wider than (R_sun + r) / d, so candidates
+// are found by an azimuth sweep over occluders sorted around the light, then a cone test.
+static const int kMaxOccluders = 4;                 // matches occluders[] in fsSrc
+
+struct EclipseCaster { float azimuth; int body; };
+struct Eclipses {
+    std::vector<EclipseCaster> sorted;              // occluders by azimuth around the light
+    std::vector<glm::vec3> rel;                     // sphere centres relative to the light
+    std::vector<glm::vec4> occ;                     // kMaxOccluders slots per receiver: centre, radius
+    std::vector<int> count;                         // occluders used per receiver
+    int shadowed = 0;                               // receivers with at least one occluder, for the stats line
+};
+
+// receivers are the first bodyCount spheres (the bodies, which are also the occluders) followed by
+// any extra spheres, e.g. ring extents, which their own planet may shade; the slots keep world centres
+static void findEclipses(Eclipses& ec, const std::vector<glm::vec3>& world, const std::vector<float>& radius,
+                         size_t bodyCount, const glm::vec3& lightPos, float lightRadius) {
+    size_t n = world.size();
+    ec.rel.resize(n);
+    for (size_t i = 0; i < n; ++i) ec.rel[i] = world[i] - lightPos;
+    const std::vector<glm::vec3>& center = ec.rel;
+    ec.sorted.clear();
+    ec.occ.assign(n * kMaxOccluders, glm::vec4(0));
+    ec.count.assign(n, 0);
+    ec.shadowed = 0;
+    float maxReach = 0.0f;
+    for (size_t i = 0; i < bodyCount; ++i) {
+        float d = glm::length(center[i]);
+        if (d <= lightRadius + radius[i]) continue; // the light itself, or something touching it
+        ec.sorted.push_back({ std::atan2(center[i].z, center[i].x), (int)i });
+        maxReach = std::max(maxReach, (lightRadius + radius[i]) / d);
+    }
+    if (ec.sorted.empty()) return;
+    std::sort(ec.sorted.begin(), ec.sorted.end(), [](const EclipseCaster& a, const EclipseCaster& b) { return a.azimuth < b.azimuth; });
+    const float pi = glm::pi<float>();
+
+    struct Candidate { float score; int body; };
+    std::vector<Candidate> cand;
+    for (size_t r = 0; r < n; ++r) {
+        float dB = glm::length(center[r]);
+        if (dB <= lightRadius + radius[r]) continue;
+        float beta = std::asin(std::min(1.0f, radius[r] / dB));
+        float elev = std::asin(glm::clamp(center[r].y / dB, -1.0f, 1.0f));
+        float window = beta + maxReach;
+        // azimuth spreads with elevation; near the poles fall back to testing every occluder
+        float span = std::fabs(elev) + window < 1.2f ? window / std::cos(std::fabs(elev) + window) : pi;
+        float az = std::atan2(center[r].z, center[r].x);
+        float lo = std::remainder(az - span, 2.0f * pi);
+        auto first = std::lower_bound(ec.sorted.begin(), ec.sorted.end(), lo,
+                                      [](const EclipseCaster& c, float v) { return c.azimuth < v; });
+        size_t start = span >= pi ? 0 : (size_t)(first - ec.sorted.begin());
+        cand.clear();
+        for (size_t k = 0; k < ec.sorted.size(); ++k) {
+            const EclipseCaster& c = ec.sorted[(start + k) % ec.sorted.size()];
+            float dAz = std::fabs(std::remainder(c.azimuth - az, 2.0f * pi));
+            if (dAz > span) break;
+            int o = c.body;
+            if ((size_t)o == r) continue;
+            float dO = glm::length(center[o]);
+            if (dO >= dB + radius[r]) continue;     // behind the receiver's far side
+            float reach = (lightRadius + radius[o]) / dO;
+            float theta = std::acos(glm::clamp(glm::dot(center[o], center[r]) / (dO * dB), -1.0f, 1.0f));
+            if (theta < reach + beta) cand.push_back({ theta - reach, o });
+        }
+        if (cand.empty()) continue;
+        size_t keep = std::min(cand.size(), (size_t)kMaxOccluders);
+        std::partial_sort(cand.begin(), cand.begin() + keep, cand.end(),
+                          [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+        for (size_t k = 0; k < keep; ++k) ec.occ[r * kMaxOccluders + k] = glm::vec4(world[cand[k].body], radius[cand[k].body]);
+        ec.count[r] = (int)keep;
+        ++ec.shadowed;
+    }
+}
+
+// ===================== LIGHT CLUSTERS =====================
+// The scene's first light is the primary: its position and colour stay plain uniforms, since
+// eclipses are computed against it. Every other point light is binned on the CPU each frame into
+// a 16x9x24 grid of view-space clusters (screen tiles x exponential depth slices). The lit shader
+// looks up its fragment's cluster and walks only that list, so a fragment pays for the lights
+// that can reach it rather than for every light in the scene. Three texture buffers carry the
+// result: light data, per-cluster (first, count) and the flattened index lists.
+static const int kClusterCount = kClusterX * kClusterY * kClusterZ;
+
+struct PointLight { glm::vec3 pos; float range; glm::vec3 color; };   // range 0 reaches everywhere
+
+struct LightClusters {
+    GLuint lightBuf = 0, gridBuf = 0, indexBuf = 0, lightTex = 0, gridTex = 0, indexTex = 0;
+    std::vector<glm::vec4> lightData;                   // two texels per light: position, range | colour
+    std::vector<uint32_t> grid;                         // per cluster: first index, count
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> pairCluster, pairLight;       // binning output, before the counting sort
+    glm::vec4 params{ 0.0f };                           // tile width, tile height (px), slice scale, slice bias
+    int lights = 0;                                     // stats: lights binned and cluster entries written
+    size_t references = 0;
+};
 
-// focus cam
-int focusIndex = 0;
-float focusDist = 12.0f;
+static void lightClustersInit(LightClusters& lc) {
+    GLuint* bufs[] = { &lc.lightBuf, &lc.gridBuf, &lc.indexBuf };
+    GLuint* texs[] = { &lc.lightTex, &lc.gridTex, &lc.indexTex };
+    const GLenum fmts[] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+    for (int i = 0; i < 3; ++i) {
+        glGenBuffers(1, bufs[i]); glGenTextures(1, texs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, *bufs[i]);
+        gpuBufferData(GL_ARRAY_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, *texs[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, fmts[i], *bufs[i]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    lc.grid.assign(kClusterCount * 2, 0);
+}
 
-// fullscreen tracking
-bool fullscreen = false;
-int savedX = 100, savedY = 100, savedW = 1280, savedH = 720;
+// conservative cluster box for each light: depth slices from its view-space z extent, tiles from
+// the projection of that extent (the full screen once it reaches the near plane)
+static void buildLightClusters(LightClusters& lc, const std::vector<PointLight>& lights, const glm::mat4& view,
+                               const glm::mat4& proj, float nearZ, float farZ, int fbW, int fbH) {
+    const float logRange = std::log(farZ / nearZ);
+    lc.params = glm::vec4((float)fbW / kClusterX, (float)fbH / kClusterY, kClusterZ / logRange, -kClusterZ * std::log(nearZ) / logRange);
+    auto slice = [&](float z) { return glm::clamp((int)std::floor(std::log(std::max(z, nearZ)) * lc.params.z + lc.params.w), 0, kClusterZ - 1); };
+    auto tile = [](float ndc, int n) { return glm::clamp((int)std::floor((ndc * 0.5f + 0.5f) * n), 0, n - 1); };
+    lc.pairCluster.clear(); lc.pairLight.clear(); lc.lightData.clear();
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const PointLight& L = lights[i];
+        int x0 = 0, x1 = kClusterX - 1, y0 = 0, y1 = kClusterY - 1, z0 = 0, z1 = kClusterZ - 1;
+        if (L.range > 0.0f) {
+            glm::vec3 c = glm::vec3(view * glm::vec4(L.pos, 1.0f));
+            float r = L.range, zMin = -c.z - r, zMax = -c.z + r;
+            if (zMax < nearZ || zMin > farZ) continue;
+            z0 = slice(zMin); z1 = slice(zMax);
+            if (zMin > nearZ) {
+                // x/z over z in [zMin, zMax] is extreme at one end, picked by the sign of x
+                auto lo = [&](float v) { return v < 0.0f ? v / zMin : v / zMax; };
+                auto hi = [&](float v) { return v > 0.0f ? v / zMin : v / zMax; };
+                float nx0 = proj[0][0] * lo(c.x - r), nx1 = proj[0][0] * hi(c.x + r);
+                float ny0 = proj[1][1] * lo(c.y - r), ny1 = proj[1][1] * hi(c.y + r);
+                if (nx0 > 1.0f || nx1 < -1.0f || ny0 > 1.0f || ny1 < -1.0f) continue;   // off screen
+                x0 = tile(nx0, kClusterX); x1 = tile(nx1, kClusterX);
+                y0 = tile(ny0, kClusterY); y1 = tile(ny1, kClusterY);
+            }
+        }
+        uint32_t li = (uint32_t)lc.lightData.size() / 2;
+        lc.lightData.push_back(glm::vec4(L.pos, L.range));
+        lc.lightData.push_back(glm::vec4(L.color, 0.0f));
+        for (int z = z0; z <= z1; ++z)
+            for (int y = y0; y <= y1; ++y)
+                for (int x = x0; x <= x1; ++x) {
+                    lc.pairCluster.push_back((uint32_t)((z * kClusterY + y) * kClusterX + x));
+                    lc.pairLight.push_back(li);
+                }
+    }
+    // counting sort by cluster: grid holds (first, count), indices the lists back to back
+    std::fill(lc.grid.begin(), lc.grid.end(), 0u);
+    for (uint32_t c : lc.pairCluster) ++lc.grid[c * 2 + 1];
+    uint32_t first = 0;
+    for (int c = 0; c < kClusterCount; ++c) { lc.grid[c * 2] = first; first += lc.grid[c * 2 + 1]; lc.grid[c * 2 + 1] = 0; }
+    lc.indices.resize(lc.pairCluster.size());
+    for (size_t k = 0; k < lc.pairCluster.size(); ++k) {
+        uint32_t* g = &lc.grid[lc.pairCluster[k] * 2];
+        lc.indices[g[0] + g[1]++] = lc.pairLight[k];
+    }
+    lc.lights = (int)lc.lightData.size() / 2;
+    lc.references = lc.indices.size();
 
-// ===================== SHADERS =====================
-static const char* vsSrc = R"(#version 330 core
-layout (location=0) in vec3 aPos;
-layout (location=1) in vec3 aNormal;
-layout (location=2) in vec2 aUV;
-uniform mat4 model, view, projection;
-out vec3 FragPos; out vec3 Normal; out vec2 UV;
-void main(){
-  FragPos = vec3(model * vec4(aPos,1.0));
-  Normal  = mat3(transpose(inverse(model))) * aNormal;
-  UV = aUV;
-  gl_Position = projection * view * vec4(FragPos,1.0);
-})";
+    auto upload = [](GLuint buf, const void* data, size_t bytes) {
+        glBindBuffer(GL_ARRAY_BUFFER, buf);
+        gpuBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)std::max<size_t>(bytes, 16), nullptr, GL_STREAM_DRAW);   // orphan
+        if (bytes) glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, data);
+    };
+    upload(lc.lightBuf, lc.lightData.data(), lc.lightData.size() * sizeof(glm::vec4));
+    upload(lc.gridBuf, lc.grid.data(), lc.grid.size() * sizeof(uint32_t));
+    upload(lc.indexBuf, lc.indices.data(), lc.indices.size() * sizeof(uint32_t));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-static const char* fsSrc = R"(#version 330 core
-out vec4 FragColor;
-in vec3 FragPos; in vec3 Normal; in vec2 UV;
-uniform vec3 lightPos, lightColor, viewPos;
-uniform sampler2D albedo;
-uniform bool useTexture;
-uniform vec3 baseColor, emissive;
-uniform float shininess;
-uniform float ks;
-void main(){
-  vec3 color = useTexture ? texture(albedo, UV).rgb : baseColor;
-  vec3 N = normalize(Normal);
-  vec3 L = normalize(lightPos - FragPos);
-  vec3 V = normalize(viewPos - FragPos);
-  vec3 H = normalize(L + V);
-  float diff = max(dot(N,L),0.0);
-  float spec = pow(max(dot(N,H),0.0), max(shininess, 1.0));
-  vec3 ambient  = 0.05 * lightColor;
-  vec3 diffuse  = diff * lightColor;
-  vec3 specular = ks * spec * lightColor;
-  vec3 lit = (ambient + diffuse + specular) * color;
-  FragColor = vec4(lit + emissive * color, 1.0);
-})";
+// texture units 3-5 belong to the clusters; the lit variants are told so when they are created
+static void lightClustersBind(const LightClusters& lc) {
+    glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_BUFFER, lc.lightTex);
+    glActiveTexture(GL_TEXTURE4); glBindTexture(GL_TEXTURE_BUFFER, lc.gridTex);
+    glActiveTexture(GL_TEXTURE5); glBindTexture(GL_TEXTURE_BUFFER, lc.indexTex);
+    glActiveTexture(GL_TEXTURE0);
+}
 
-static const char* vsLine = R"(#version 330 core
-layout (location=0) in vec3 aPos;
-uniform mat4 mvp;
-void main(){ gl_Position = mvp * vec4(aPos,1.0); })";
+// ===================== OPAQUE PASS =====================
+// Bodies are the only opaque geometry and each one runs the full lit shader. O cycles how they are
+// submitted: scene order; front to back by view depth, so nearer spheres reject what they hide at the
+// depth test; or front to back after a depth-only prepass, which leaves the lit pass exactly one
+// fragment per covered pixel. GL_SAMPLES_PASSED around the lit body draws counts what was shaded.
+enum OpaqueMode { OPAQUE_SCENE_ORDER = 0, OPAQUE_FRONT_TO_BACK = 1, OPAQUE_DEPTH_PREPASS = 2 };
+static const char* const kOpaqueModeNames[] = { "scene", "sorted", "prepass" };
+static const int kFragmentQueryFrames = 3;          // results are read this many frames late, never waited on
+
+struct FragmentCounter {
+    GLuint queries[kFragmentQueryFrames] = {};
+    bool pending[kFragmentQueryFrames] = {};
+    GLuint64 last = 0;                              // shaded fragments in the newest finished frame
+    int lastMode = -1;                              // opaque mode that frame was drawn in
+    int modes[kFragmentQueryFrames] = {};
+};
 
-static const char* fsLine = R"(#version 330 core
-out vec4 FragColor;
-uniform vec3 color;
-void main(){ FragColor = vec4(color,1.0); })";
+static void fragmentCounterInit(FragmentCounter& c) { glGenQueries(kFragmentQueryFrames, c.queries); }
 
-// ===================== GL HELPERS =====================
-static GLuint makeShader(GLenum t, const char* s) {
-    GLuint sh = glCreateShader(t); glShaderSource(sh, 1, &s, nullptr); glCompileShader(sh);
-    GLint ok; glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
-    if (!ok) { char log[1024]; glGetShaderInfoLog(sh, 1024, nullptr, log); std::cerr << "Shader: " << log << "\n"; }
-    return sh;
+// collects the slot's previous result if it is ready, then starts counting this frame into it
+static void fragmentCounterBegin(FragmentCounter& c, uint64_t frame, int mode) {
+    int s = (int)(frame % kFragmentQueryFrames);
+    if (c.pending[s]) {
+        GLuint ready = 0;
+        glGetQueryObjectuiv(c.queries[s], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (ready) { glGetQueryObjectui64v(c.queries[s], GL_QUERY_RESULT, &c.last); c.lastMode = c.modes[s]; }
+    }
+    glBeginQuery(GL_SAMPLES_PASSED, c.queries[s]);
+    c.pending[s] = true; c.modes[s] = mode;
 }
-static GLuint makeProgram(const char* vsrc, const char* fsrc) {
-    GLuint p = glCreateProgram(); GLuint v = makeShader(GL_VERTEX_SHADER, vsrc), f = makeShader(GL_FRAGMENT_SHADER, fsrc);
-    glAttachShader(p, v); glAttachShader(p, f); glLinkProgram(p);
-    GLint ok; glGetProgramiv(p, GL_LINK_STATUS, &ok);
-    if (!ok) { char log[1024]; glGetProgramInfoLog(p, 1024, nullptr, log); std::cerr << "Link: " << log << "\n"; }
-    glDeleteShader(v); glDeleteShader(f); return p;
+static void fragmentCounterEnd() { glEndQuery(GL_SAMPLES_PASSED); }
+
+// body indices nearest first, by view depth of each sphere's front
+static void sortFrontToBack(std::vector<size_t>& order, const std::vector<glm::mat4>& world,
+                            const std::vector<float>& radius, const glm::mat4& view) {
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        float za = -(view * world[a][3]).z - radius[a], zb = -(view * world[b][3]).z - radius[b];
+        return za < zb;
+    });
 }
-static GLuint loadTexture2D(const char* path, bool flipY = true) {
-    stbi_set_flip_vertically_on_load(flipY);
-    int w, h, ch; unsigned char* data = stbi_load(path, &w, &h, &ch, 0);
-    if (!data) { std::cerr << "Texture failed: " << path << " (" << stbi_failure_reason() << ")\n"; return 0; }
-    GLenum fmt = ch == 1 ? GL_RED : ch == 3 ? GL_RGB : GL_RGBA;
-    GLuint t; glGenTextures(1, &t); glBindTexture(GL_TEXTURE_2D, t);
-    glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    stbi_image_free(data); return t;
+
+// ===================== HDR POST =====================
+// The scene renders into an RGBA16F target, so the 7x light colour and the Sun's emissive keep
+// their range instead of clipping in an 8-bit buffer; the resolve tonemaps it into the window (or
+// the benchmark target). Bloom runs on a pyramid of R11G11B10F levels starting at half size: the
+// first level thresholds the bright pixels, each further level box-filters the one above, and the
+// way back up tent-filters each level and adds it onto the next larger one. Every level has a
+// quarter of the pixels of the one above, so the whole chain costs little more than one pass at
+// half resolution. Each stage is timed with GL_TIME_ELAPSED, read a few frames late like the
+// fragment counter.
+enum PostStage { POST_SCENE = 0, POST_BLOOM_DOWN = 1, POST_BLOOM_UP = 2, POST_TONEMAP = 3, POST_STAGES = 4 };
+static const int kBloomLevels = 6, kBloomMinSize = 8;
+static const float kBloomThreshold = 1.0f, kBloomKnee = 0.5f, kBloomStrength = 0.5f, kExposure = 1.0f;
+static const int kPostQueryFrames = 3;
+
+struct HdrPost {
+    GLuint fbo = 0, color = 0, depth = 0;           // the scene target
+    GLuint bloomFbo[kBloomLevels] = {}, bloomTex[kBloomLevels] = {};
+    int bloomW[kBloomLevels] = {}, bloomH[kBloomLevels] = {};
+    int w = 0, h = 0, levels = 0;
+    GLuint downProg = 0, upProg = 0, tonemapProg = 0, vao = 0;
+    GLuint queries[kPostQueryFrames][POST_STAGES] = {};
+    unsigned issued[kPostQueryFrames] = {};         // stage bits started in that frame, not yet collected
+    double ms[POST_STAGES] = {};                    // newest finished frame's GPU time per stage
+};
+
+static void hdrPostInit(HdrPost& hp) {
+    hp.downProg = makeProgram(vsPost, fsBloomDown);
+    hp.upProg = makeProgram(vsPost, fsBloomUp);
+    hp.tonemapProg = makeProgram(vsPost, fsTonemap);
+    glGenVertexArrays(1, &hp.vao);                  // the post triangle has no vertex data
+    glGenQueries(kPostQueryFrames * POST_STAGES, &hp.queries[0][0]);
+    glGenFramebuffers(1, &hp.fbo); glGenTextures(1, &hp.color); glGenRenderbuffers(1, &hp.depth);
+    glGenFramebuffers(kBloomLevels, hp.bloomFbo); glGenTextures(kBloomLevels, hp.bloomTex);
 }
 
-// ===================== MESHES =====================
-struct Mesh { GLuint VAO = 0, VBO = 0, EBO = 0; int indexCount = 0; };
-struct Vtx { glm::vec3 p; glm::vec3 n; glm::vec2 uv; };
+static void postTexture(GLuint tex, GLint internalFormat, int w, int h) {
+    glBindTexture(GL_TEXTURE_2D, tex);
+    gpuTexImage2D(0, internalFormat, w, h, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
 
-static Mesh buildSphere(int stacks, int slices, float r) {
-    std::vector<Vtx> v; std::vector<unsigned int> idx;
-    for (int i = 0; i <= stacks; ++i) {
-        float fv = (float)i / stacks, phi = fv * glm::pi<float>();
-        float y = cosf(phi), rr = sinf(phi);
-        for (int j = 0; j <= slices; ++j) {
-            float fu = (float)j / slices, th = fu * glm::two_pi<float>();
-            float x = rr * cosf(th), z = rr * sinf(th);
-            glm::vec3 n = glm::normalize(glm::vec3(x, y, z));
-            v.push_back({ r * glm::vec3(x,y,z), n, glm::vec2(fu,1.0f - fv) });
-        }
+// (re)allocates the scene target and the pyramid when the framebuffer size changes
+static void hdrPostResize(HdrPost& hp, int w, int h) {
+    if (w == hp.w && h == hp.h) return;
+    hp.w = w; hp.h = h;
+    postTexture(hp.color, GL_RGBA16F, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, hp.depth);
+    gpuRenderbufferStorage(GL_DEPTH_COMPONENT24, w, h);
+    glBindFramebuffer(GL_FRAMEBUFFER, hp.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hp.color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, hp.depth);
+    hp.levels = 0;
+    for (int bw = w / 2, bh = h / 2; hp.levels < kBloomLevels && std::min(bw, bh) >= kBloomMinSize; bw /= 2, bh /= 2) {
+        int l = hp.levels++;
+        hp.bloomW[l] = bw; hp.bloomH[l] = bh;
+        postTexture(hp.bloomTex[l], GL_R11F_G11F_B10F, bw, bh);
+        glBindFramebuffer(GL_FRAMEBUFFER, hp.bloomFbo[l]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hp.bloomTex[l], 0);
     }
-    for (int i = 0; i < stacks; ++i) {
-        for (int j = 0; j < slices; ++j) {
-            int r1 = i * (slices + 1), r2 = (i + 1) * (slices + 1);
-            idx.push_back(r1 + j); idx.push_back(r2 + j); idx.push_back(r2 + j + 1);
-            idx.push_back(r1 + j); idx.push_back(r2 + j + 1); idx.push_back(r1 + j + 1);
+    // levels a smaller window no longer needs give their storage back
+    for (int l = hp.levels; l < kBloomLevels; ++l)
+        if (gpuTextures[hp.bloomTex[l]].w) postTexture(hp.bloomTex[l], GL_R11F_G11F_B10F, 0, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// the first timer of a frame collects what finished in its slot three frames ago
+static void postTimerBegin(HdrPost& hp, uint64_t frame, int stage) {
+    int s = (int)(frame % kPostQueryFrames);
+    if (stage == POST_SCENE && hp.issued[s]) {
+        GLuint ready = 0;
+        glGetQueryObjectuiv(hp.queries[s][POST_TONEMAP], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (ready) {
+            for (int k = 0; k < POST_STAGES; ++k) {
+                GLuint64 ns = 0;
+                if (hp.issued[s] & (1u << k)) glGetQueryObjectui64v(hp.queries[s][k], GL_QUERY_RESULT, &ns);
+                hp.ms[k] = ns / 1e6;
+            }
         }
+        hp.issued[s] = 0;
     }
-    Mesh m; m.indexCount = (int)idx.size();
-    glGenVertexArrays(1, &m.VAO); glGenBuffers(1, &m.VBO); glGenBuffers(1, &m.EBO);
-    glBindVertexArray(m.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
-    glBufferData(GL_ARRAY_BUFFER, v.size() * sizeof(Vtx), v.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned int), idx.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)0); glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, n)); glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, uv)); glEnableVertexAttribArray(2);
-    glBindVertexArray(0); return m;
+    glBeginQuery(GL_TIME_ELAPSED, hp.queries[s][stage]);
+    hp.issued[s] |= 1u << stage;
 }
+static void postTimerEnd() { glEndQuery(GL_TIME_ELAPSED); }
 
-static Mesh buildRing(int segments, float innerR, float outerR) {
-    std::vector<Vtx> v; std::vector<unsigned int> idx;
-    for (int i = 0; i <= segments; ++i) {
-        float u = (float)i / segments, th = u * glm::two_pi<float>(), c = cosf(th), s = sinf(th);
-        v.push_back({ glm::vec3(outerR * c,0,outerR * s),glm::vec3(0,1,0),glm::vec2(u,1) });
-        v.push_back({ glm::vec3(innerR * c,0,innerR * s),glm::vec3(0,1,0),glm::vec2(u,0) });
-        if (i < segments) {
-            int b = i * 2; idx.push_back(b); idx.push_back(b + 1); idx.push_back(b + 2);
-            idx.push_back(b + 1); idx.push_back(b + 3); idx.push_back(b + 2);
+static void postPass(GLuint prog, GLuint src, int srcW, int srcH) {
+    glUseProgram(prog);
+    glUniform1i(glGetUniformLocation(prog, "src"), 0);
+    glUniform2f(glGetUniformLocation(prog, "texel"), 1.0f / srcW, 1.0f / srcH);
+    glBindTexture(GL_TEXTURE_2D, src);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// bloom pyramid, then the tonemap into outFbo (upscaling when the scene was drawn smaller, see
+// RENDER SCALE); leaves depth test and blending as the scene expects
+static void hdrPostResolve(HdrPost& hp, GLuint outFbo, int outW, int outH, bool bloom, uint64_t frame) {
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(hp.vao);
+    glActiveTexture(GL_TEXTURE0);
+    bloom = bloom && hp.levels > 0;
+    if (bloom) {
+        postTimerBegin(hp, frame, POST_BLOOM_DOWN);
+        glUseProgram(hp.downProg);
+        for (int l = 0; l < hp.levels; ++l) {
+            glUniform2f(glGetUniformLocation(hp.downProg, "threshold"), l ? 0.0f : kBloomThreshold, l ? 0.0f : kBloomKnee);
+            glBindFramebuffer(GL_FRAMEBUFFER, hp.bloomFbo[l]);
+            glViewport(0, 0, hp.bloomW[l], hp.bloomH[l]);
+            if (l) postPass(hp.downProg, hp.bloomTex[l - 1], hp.bloomW[l - 1], hp.bloomH[l - 1]);
+            else postPass(hp.downProg, hp.color, hp.w, hp.h);
+        }
+        postTimerEnd();
+        postTimerBegin(hp, frame, POST_BLOOM_UP);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        for (int l = hp.levels - 1; l > 0; --l) {
+            glBindFramebuffer(GL_FRAMEBUFFER, hp.bloomFbo[l - 1]);
+            glViewport(0, 0, hp.bloomW[l - 1], hp.bloomH[l - 1]);
+            postPass(hp.upProg, hp.bloomTex[l], hp.bloomW[l], hp.bloomH[l]);
         }
+        glDisable(GL_BLEND);
+        postTimerEnd();
     }
-    Mesh m; m.indexCount = (int)idx.size();
-    glGenVertexArrays(1, &m.VAO); glGenBuffers(1, &m.VBO); glGenBuffers(1, &m.EBO);
-    glBindVertexArray(m.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
-    glBufferData(GL_ARRAY_BUFFER, v.size() * sizeof(Vtx), v.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned int), idx.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)0); glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, n)); glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vtx), (void*)offsetof(Vtx, uv)); glEnableVertexAttribArray(2);
-    glBindVertexArray(0); return m;
+    postTimerBegin(hp, frame, POST_TONEMAP);
+    glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+    glViewport(0, 0, outW, outH);
+    glUseProgram(hp.tonemapProg);
+    glUniform1i(glGetUniformLocation(hp.tonemapProg, "hdr"), 0);
+    glUniform1i(glGetUniformLocation(hp.tonemapProg, "bloom"), 1);
+    glUniform1f(glGetUniformLocation(hp.tonemapProg, "exposure"), kExposure);
+    glUniform1f(glGetUniformLocation(hp.tonemapProg, "bloomStrength"), bloom ? kBloomStrength : 0.0f);
+    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, bloom ? hp.bloomTex[0] : 0);
+    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, hp.color);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    postTimerEnd();
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_DEPTH_TEST);
 }
 
-static Mesh buildOrbitLine(int segments, float r) {
-    std::vector<glm::vec3> p; std::vector<unsigned int> idx;
-    for (int i = 0; i < segments; ++i) {
-        float u = (float)i / segments, th = u * glm::two_pi<float>();
-        p.push_back(glm::vec3(r * cosf(th), 0, r * sinf(th)));
-        idx.push_back(i); idx.push_back((i + 1) % segments);
-    }
-    Mesh m; m.indexCount = (int)idx.size();
-    glGenVertexArrays(1, &m.VAO); glGenBuffers(1, &m.VBO); glGenBuffers(1, &m.EBO);
-    glBindVertexArray(m.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
-    glBufferData(GL_ARRAY_BUFFER, p.size() * sizeof(glm::vec3), p.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned int), idx.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0); glEnableVertexAttribArray(0);
-    glBindVertexArray(0); return m;
+// ===================== RENDER SCALE =====================
+// The 3D scene (the HdrPost target) can be drawn below window resolution. The tonemap pass
+// upsamples it bilinearly to the window and the HUD is drawn on top at native size. Only the GPU
+// time of the scene and post passes goes with scale^2, so the controller steers that toward the
+// --target-fps budget: scale * sqrt(budget * headroom / gpu). The main thread's CPU time (binning,
+// orbits, residency, driver waits) does not shrink with resolution and acts as a floor: the scale
+// never drops below the point where the GPU would get under it, so a CPU-bound frame keeps its
+// resolution. Changes are at most 10%, in 0.05 steps, and wait for the smoothed times to settle.
+static const float kRenderScaleMin = 0.5f, kRenderScaleQuantum = 0.05f, kRenderScaleHeadroom = 0.9f;
+static const int kRenderScaleSettleFrames = 20;
+
+struct RenderScale {
+    float scale = 1.0f;
+    bool dynamic = true;                            // false: --render-scale, or a benchmark
+    double budgetMs = 1000.0 / 60.0;                // --target-fps
+    double cpuMs = 0.0, gpuMs = 0.0;                // smoothed frame costs
+    int settle = kRenderScaleSettleFrames;
+    int changes = 0;
+};
+
+static int scaledSize(int px, float scale) { return std::max(1, (int)std::lround(px * scale)); }
+
+static void renderScaleUpdate(RenderScale& rs, double cpuMs, double gpuMs) {
+    rs.cpuMs += 0.15 * (cpuMs - rs.cpuMs);
+    rs.gpuMs += 0.15 * (gpuMs - rs.gpuMs);
+    if (!rs.dynamic || --rs.settle > 0) return;
+    if (rs.gpuMs <= 0.0) return;                    // no timer results yet
+    float want = rs.scale * (float)std::sqrt(rs.budgetMs * kRenderScaleHeadroom / rs.gpuMs);
+    if (want < rs.scale)                            // below the CPU floor a smaller target buys nothing
+        want = std::min(rs.scale, std::max(want, rs.scale * (float)std::sqrt(rs.cpuMs / rs.gpuMs)));
+    want = glm::clamp(want, rs.scale * 0.9f, rs.scale * 1.1f);
+    want = glm::clamp(std::round(want / kRenderScaleQuantum) * kRenderScaleQuantum, kRenderScaleMin, 1.0f);
+    if (std::fabs(want - rs.scale) < 0.5f * kRenderScaleQuantum) return;
+    rs.scale = want;
+    rs.settle = kRenderScaleSettleFrames;
+    ++rs.changes;
 }
 
-// ===================== PLANET =====================
-struct Planet {
-    Mesh mesh; GLuint tex = 0;
-    float orbitRadius = 0, orbitSpeed = 0, spinSpeed = 0;
-    float orbitAngle = 0, spinAngle = 0;
+// ===================== FRAME PACING =====================
+// Frames are paced by vsync (V toggles, --no-vsync) and/or a frame cap (--fps-cap N). When the sim
+// is paused the cap drops to --paused-fps (default 15) so an idle window stops burning a core.
+// The cap keeps an absolute deadline per frame. It sleeps until just short of the deadline, then
+// spins the rest. The margin it leaves tracks how late the OS has been waking it, so a coarse
+// sleep (Windows' 15.6 ms tick) ends up spinning more instead of missing the deadline. Jitter is
+// the spread of the frame-to-frame intervals over each stats window.
+// Rendering is also on demand: once nothing that reaches the image (camera, simulation state,
+// toggles, window and render size, texture streaming) has changed for a few presented frames, the
+// loop stops drawing and sleeps in glfwWaitEventsTimeout, leaving the last frame on screen. The
+// settle frames let the one-frame-late VT feedback and residency catch up before it goes quiet;
+// the refresh callback forces a redraw when the window system loses the contents.
+static const double kPaceMarginMin = 0.0005, kPaceMarginMax = 0.020;
+static const int kIdleSettleFrames = 3;
+static const double kIdleWaitSeconds = 0.25;        // wakes this often anyway, for state nothing signals
+
+struct FramePacer {
+    double next = 0.0;                              // deadline of the frame being paced
+    double margin = 0.002;                          // left for spinning, seconds
+    double last = 0.0;                              // when the previous frame was released
+    double sum = 0.0, sumSq = 0.0, worst = 0.0;     // intervals in this stats window, ms
+    int count = 0;
+    double meanMs = 0.0, jitterMs = 0.0, worstMs = 0.0;   // the last finished window
 };
 
-// ===================== CAMERA HELPERS =====================
-static glm::vec3 orbitCamPos() {
-    float cp = cosf(camPitch), sp = sinf(camPitch), sy = sinf(camYaw), cy = cosf(camYaw);
-    return { camDist * cp * sy, camDist * sp, camDist * cp * cy };
+// blocks until the frame's slot at `fps` (no wait for fps <= 0), then records the interval
+static void framePace(FramePacer& fp, double fps) {
+    double now = glfwGetTime();
+    if (fps > 0.0) {
+        fp.next += 1.0 / fps;
+        if (fp.next < now) fp.next = now;           // late: restart the schedule rather than racing to catch up
+        double wake = fp.next - fp.margin;
+        if (wake > now) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wake - now));
+            double overshoot = glfwGetTime() - wake;
+            fp.margin = glm::clamp(std::max(fp.margin * 0.98, overshoot * 1.25), kPaceMarginMin, kPaceMarginMax);
+        }
+        while ((now = glfwGetTime()) < fp.next) std::this_thread::yield();
+    }
+    else fp.next = now;
+    if (fp.last > 0.0) {
+        double ms = (now - fp.last) * 1000.0;
+        fp.sum += ms; fp.sumSq += ms * ms; fp.worst = std::max(fp.worst, ms); ++fp.count;
+    }
+    fp.last = now;
 }
+
+// closes the stats window: mean interval, its standard deviation and the longest one
+static void framePacerReport(FramePacer& fp) {
+    if (!fp.count) return;
+    fp.meanMs = fp.sum / fp.count;
+    fp.jitterMs = std::sqrt(std::max(0.0, fp.sumSq / fp.count - fp.meanMs * fp.meanMs));
+    fp.worstMs = fp.worst;
+    fp.sum = fp.sumSq = fp.worst = 0.0; fp.count = 0;
+}
+static const int kReadoutDetailEvery = 10;          // console readouts (two a second) per detail block
+
+// ===================== CAMERA HELPERS =====================
+static glm::vec3 orbitCamPos() { return orbitCamPos(camYaw, camPitch, camDist); }
 static void toggle_fullscreen(GLFWwindow* w) {
     if (!fullscreen) {
         glfwGetWindowPos(w, &savedX, &savedY);
@@ -267,8 +2913,246 @@ static void toggle_fullscreen(GLFWwindow* w) {
     }
 }
 
+// ===================== INPUT RECORDING =====================
+// --record <file> logs, per frame: dt, the polled key state, the framebuffer size, every input
+// event delivered during glfwPollEvents and a hash of the simulation state. --replay <file>
+// ignores live input and feeds those back at the same points of the frame, so the simulation
+// runs bit-for-bit identically; any hash mismatch is reported with its frame number.
+static const uint32_t kInputLogVersion = 1;
+enum InputEventType : uint32_t { IE_KEY = 1, IE_MOUSE_BUTTON = 2, IE_CURSOR = 3, IE_SCROLL = 4 };
+struct InputEvent { uint32_t type; int32_t a, b, c; double x, y; };   // a/b/c: key|button, action, mods
+struct InputLogFrame { float dt; uint32_t keyMask; int32_t winW, winH; uint64_t stateHash; uint32_t eventCount, pad; };
+static_assert(sizeof(InputEvent) == 32 && sizeof(InputLogFrame) == 32, "input log records are part of the file format");
+
+// keys the main loop polls every frame, one bit each
+static const int kPolledKeys[] = { GLFW_KEY_SPACE, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E, GLFW_KEY_W, GLFW_KEY_S };
+
+enum InputMode { INPUT_LIVE, INPUT_RECORD, INPUT_REPLAY };
+struct InputLog {
+    InputMode mode = INPUT_LIVE;
+    uint32_t keyMask = 0;
+    std::vector<InputEvent> events;          // recording: this frame's events
+    std::ofstream out;                       // recording
+    MappedFile in; size_t cursor = 0;        // replay
+    InputLogFrame frame{};                   // replay: the frame being played
+    uint64_t frames = 0, divergedAt = 0; bool diverged = false;
+    double wallStart = 0.0;
+};
+static InputLog inputLog;
+static void dispatchInput(GLFWwindow* w, const InputEvent& e);
+
+// stands in for glfwGetKey so replay can answer from the log
+static bool keyDown(int key) {
+    for (int i = 0; i < (int)(sizeof(kPolledKeys) / sizeof(kPolledKeys[0])); ++i)
+        if (kPolledKeys[i] == key) return (inputLog.keyMask >> i) & 1u;
+    return false;
+}
+// false while replaying: live events are dropped so only the log drives the session
+static bool liveInput(const InputEvent& e) {
+    if (inputLog.mode == INPUT_REPLAY) return false;
+    if (inputLog.mode == INPUT_RECORD) inputLog.events.push_back(e);
+    return true;
+}
+
+static bool inputStartRecording(const char* path) {
+    inputLog.out.open(path, std::ios::binary);
+    if (!inputLog.out) { std::cerr << "Cannot write input log " << path << "\n"; return false; }
+    uint32_t hd[4] = { 0, kInputLogVersion, 0, 0 };
+    std::memcpy(hd, "SSIR", 4);
+    inputLog.out.write((const char*)hd, sizeof(hd));
+    inputLog.mode = INPUT_RECORD;
+    return true;
+}
+static bool inputStartReplay(const char* path) {
+    uint32_t hd[4];
+    if (!mapFile(path, inputLog.in) || inputLog.in.size < sizeof(hd)) { std::cerr << "Cannot read input log " << path << "\n"; return false; }
+    std::memcpy(hd, inputLog.in.data, sizeof(hd));
+    if (std::memcmp(hd, "SSIR", 4) != 0 || hd[1] != kInputLogVersion) {
+        std::cerr << "Not an input log (or an old version): " << path << "\n"; unmapFile(inputLog.in); return false;
+    }
+    inputLog.cursor = sizeof(hd); inputLog.mode = INPUT_REPLAY;
+    return true;
+}
+
+// top of the frame: fixes dt, polled keys and viewport size; false once a replay runs out
+static bool inputBeginFrame(GLFWwindow* win, float& dt) {
+    InputLog& L = inputLog;
+    if (L.frames == 0) L.wallStart = glfwGetTime();
+    if (L.mode != INPUT_REPLAY) {
+        L.keyMask = 0;
+        for (int i = 0; i < (int)(sizeof(kPolledKeys) / sizeof(kPolledKeys[0])); ++i)
+            if (glfwGetKey(win, kPolledKeys[i]) == GLFW_PRESS) L.keyMask |= 1u << i;
+        L.frame.dt = dt; L.frame.keyMask = L.keyMask; L.frame.winW = winW; L.frame.winH = winH;
+        return true;
+    }
+    if (L.cursor + sizeof(InputLogFrame) > L.in.size) return false;
+    std::memcpy(&L.frame, L.in.data + L.cursor, sizeof(InputLogFrame));
+    if (L.cursor + sizeof(InputLogFrame) + (size_t)L.frame.eventCount * sizeof(InputEvent) > L.in.size) return false;
+    dt = L.frame.dt; L.keyMask = L.frame.keyMask; winW = L.frame.winW; winH = L.frame.winH;
+    return true;
+}
+// after glfwPollEvents: replay applies the logged events, then both modes settle the state hash
+static void inputEndFrame(GLFWwindow* win, const std::function<uint64_t()>& stateHash) {
+    InputLog& L = inputLog;
+    if (L.mode == INPUT_REPLAY) {
+        const unsigned char* ev = L.in.data + L.cursor + sizeof(InputLogFrame);
+        for (uint32_t i = 0; i < L.frame.eventCount; ++i) {
+            InputEvent e; std::memcpy(&e, ev + (size_t)i * sizeof(InputEvent), sizeof(e));
+            dispatchInput(win, e);
+        }
+        L.cursor += sizeof(InputLogFrame) + (size_t)L.frame.eventCount * sizeof(InputEvent);
+        if (!L.diverged && stateHash() != L.frame.stateHash) {
+            L.diverged = true; L.divergedAt = L.frames;
+            std::cout << "\nReplay diverged from the recording at frame " << L.frames << "\n";
+        }
+    }
+    else if (L.mode == INPUT_RECORD) {
+        L.frame.stateHash = stateHash(); L.frame.eventCount = (uint32_t)L.events.size(); L.frame.pad = 0;
+        L.out.write((const char*)&L.frame, sizeof(L.frame));
+        if (!L.events.empty()) L.out.write((const char*)L.events.data(), L.events.size() * sizeof(InputEvent));
+        L.events.clear();
+    }
+    L.frames++;
+}
+static void inputFinish() {
+    InputLog& L = inputLog;
+    double wall = glfwGetTime() - L.wallStart;
+    if (L.mode == INPUT_RECORD) { L.out.close(); std::cout << "Recorded " << L.frames << " frames\n"; }
+    if (L.mode == INPUT_REPLAY) {
+        std::cout << "Replayed " << L.frames << " frames in " << wall << " s ("
+                  << (L.frames ? wall * 1000.0 / L.frames : 0.0) << " ms/frame), "
+                  << (L.diverged ? "DIVERGED" : "state matched the recording") << "\n";
+        unmapFile(L.in);
+    }
+}
+
+// ===================== BENCHMARK =====================
+// --bench [name] runs scripted camera paths offscreen (hidden window, fixed-size FBO, fixed 60 Hz
+// simulation step, no vsync) and writes frame-time statistics to JSON. Each path is a list of
+// keyframes; continuous values follow a Catmull-Rom spline, camMode/focusIndex step at each key.
+static const float kBenchStep = 1.0f / 60.0f;
+static const int kBenchWarmupFrames = 30;
+static const int kBenchW = 1280, kBenchH = 720;
+
+struct CamKey {
+    float t; CamMode mode; int focus;
+    float yaw, pitch, dist, fov, focusDist;
+    glm::vec3 pos; float freeYaw, freePitch;
+};
+struct BenchScenario { std::string name; float duration; int beltRocks; std::vector<CamKey> keys; int beltLights; };
+struct BenchResult { std::string name; std::vector<double> frameMs; };
+
+static CamKey orbitKey(float t, float yawDeg, float pitchDeg, float dist, float fov = 45.0f) {
+    return { t, ORBIT, 0, glm::radians(yawDeg), glm::radians(pitchDeg), dist, fov, 12.0f, glm::vec3(0), 0.0f, 0.0f };
+}
+static CamKey focusKey(float t, int body, float yawDeg, float focusDist) {
+    return { t, FOCUS, body, glm::radians(yawDeg), glm::radians(20.0f), 45.0f, 45.0f, focusDist, glm::vec3(0), 0.0f, 0.0f };
+}
+// free-cam key looking at the Sun from pos
+static CamKey freeKey(float t, glm::vec3 pos, float fov = 60.0f) {
+    glm::vec3 d = glm::normalize(-pos);
+    return { t, FREE, 0, 0.0f, 0.0f, 45.0f, fov, 12.0f, pos, atan2f(d.x, -d.z), asinf(d.y) };
+}
+
+static std::vector<BenchScenario> benchScenarios() {
+    std::vector<BenchScenario> v;
+    v.push_back({ "orbit-overview", 12.0f, 0, {
+        orbitKey(0, 0, 15, 45), orbitKey(4, 120, 40, 90), orbitKey(8, 240, 10, 30), orbitKey(12, 360, 15, 45) }, 0 });
+    v.push_back({ "free-flythrough", 12.0f, 0, {
+        freeKey(0, { 0, 10, 60 }), freeKey(3, { 18, 3, 22 }), freeKey(6, { 14, 1, -12 }),
+        freeKey(9, { -24, 6, -6 }), freeKey(12, { -8, 18, 40 }) }, 0 });
+    CamKey k0 = focusKey(0, 1, 0, 4.0f);
+    std::vector<CamKey> focus;
+    for (int b = 1; b <= 8; ++b) focus.push_back(focusKey((b - 1) * 1.5f, b, b * 45.0f, b >= 5 ? 7.0f : 3.5f));
+    focus.push_back(k0); focus.back().t = 12.0f;
+    v.push_back({ "focus-closeup", 12.0f, 0, focus, 0 });
+    v.push_back({ "wide-fov", 12.0f, 0, {
+        orbitKey(0, 0, 30, 120, 90), orbitKey(6, 180, 60, 160, 90), orbitKey(12, 360, 30, 120, 90) }, 0 });
+    v.push_back({ "dense-belt", 12.0f, 20000, {
+        orbitKey(0, 0, 8, 40), orbitKey(4, 90, 25, 28), orbitKey(8, 200, 5, 22), orbitKey(12, 360, 8, 40) }, 0 });
+    v.push_back({ "many-lights", 12.0f, 4000, {
+        orbitKey(0, 0, 8, 40), orbitKey(4, 90, 25, 28), orbitKey(8, 200, 5, 22), orbitKey(12, 360, 8, 40) }, 512 });
+    return v;
+}
+
+static float catmullRom(float p0, float p1, float p2, float p3, float u) {
+    return 0.5f * (2 * p1 + (p2 - p0) * u + (2 * p0 - 5 * p1 + 4 * p2 - p3) * u * u + (3 * p1 - p0 - 3 * p2 + p3) * u * u * u);
+}
+// writes the camera globals for time t along the path
+static void benchApplyCamera(const std::vector<CamKey>& keys, float t) {
+    int n = (int)keys.size(), i = 0;
+    while (i + 2 < n && keys[i + 1].t <= t) ++i;
+    const CamKey& a = keys[std::max(0, i - 1)]; const CamKey& b = keys[i];
+    const CamKey& c = keys[std::min(n - 1, i + 1)]; const CamKey& d = keys[std::min(n - 1, i + 2)];
+    float u = c.t > b.t ? glm::clamp((t - b.t) / (c.t - b.t), 0.0f, 1.0f) : 0.0f;
+    auto cr = [&](float CamKey::* f) { return catmullRom(a.*f, b.*f, c.*f, d.*f, u); };
+    camMode = b.mode; focusIndex = b.focus;
+    camYaw = cr(&CamKey::yaw); camPitch = cr(&CamKey::pitch); camDist = cr(&CamKey::dist);
+    fovDeg = cr(&CamKey::fov); focusDist = cr(&CamKey::focusDist);
+    freePos = glm::vec3(catmullRom(a.pos.x, b.pos.x, c.pos.x, d.pos.x, u), catmullRom(a.pos.y, b.pos.y, c.pos.y, d.pos.y, u),
+                        catmullRom(a.pos.z, b.pos.z, c.pos.z, d.pos.z, u));
+    freeYaw = cr(&CamKey::freeYaw); freePitch = cr(&CamKey::freePitch);
+}
+
+// stress geometry: a main belt between Mars and Jupiter, one draw per rock
+struct BeltRock { float radius, angle, height, size, speed; };
+static const char* const kBeltTexture = "textures/moon.jpg";
+static std::vector<BeltRock> makeBelt(int count) {
+    std::vector<BeltRock> belt(count);
+    uint32_t seed = 12345u;
+    auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) * (1.0f / 16777216.0f); };
+    for (BeltRock& r : belt) {
+        r.radius = 16.5f + 2.5f * rnd(); r.angle = 360.0f * rnd(); r.height = (rnd() - 0.5f) * 0.8f;
+        r.size = 0.03f + 0.06f * rnd(); r.speed = 20.0f * powf(15.0f / r.radius, 1.5f);  // Kepler-ish falloff from Mars' speed
+    }
+    return belt;
+}
+static glm::vec3 beltRockPos(const BeltRock& r) {
+    return glm::vec3(glm::rotate(glm::mat4(1), glm::radians(r.angle), glm::vec3(0, 1, 0)) * glm::vec4(r.radius, r.height, 0, 1));
+}
+
+static void benchStats(const std::vector<double>& ms, double& mean, double& med, double& p95, double& p99, double& mn, double& mx, double& sd) {
+    std::vector<double> v = ms;
+    std::sort(v.begin(), v.end());
+    mean = 0; for (double x : v) mean += x; mean /= std::max<size_t>(1, v.size());
+    sd = 0; for (double x : v) sd += (x - mean) * (x - mean); sd = std::sqrt(sd / std::max<size_t>(1, v.size()));
+    auto pct = [&v](double q) { return v.empty() ? 0.0 : v[std::min(v.size() - 1, (size_t)(q * (v.size() - 1) + 0.5))]; };
+    med = pct(0.5); p95 = pct(0.95); p99 = pct(0.99);
+    mn = v.empty() ? 0 : v.front(); mx = v.empty() ? 0 : v.back();
+}
+// driver strings are arbitrary text; quotes, backslashes and control characters would break the file
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+        else if (c < 0x20) { char u[8]; std::snprintf(u, sizeof(u), "\\u%04x", c); out += u; }
+        else out += (char)c;
+    }
+    return out;
+}
+
+static bool writeBenchJson(const std::string& path, const std::vector<BenchResult>& results, const char* renderer) {
+    std::ofstream f(path);
+    if (!f) return false;
+    f << std::fixed << std::setprecision(3);
+    f << "{\n  \"renderer\": \"" << jsonEscape(renderer) << "\",\n  \"resolution\": [" << kBenchW << ", " << kBenchH << "],\n"
+      << "  \"step_ms\": " << kBenchStep * 1000.0f << ",\n  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        double mean, med, p95, p99, mn, mx, sd;
+        benchStats(results[i].frameMs, mean, med, p95, p99, mn, mx, sd);
+        f << "    { \"name\": \"" << jsonEscape(results[i].name) << "\", \"frames\": " << results[i].frameMs.size()
+          << ", \"mean_ms\": " << mean << ", \"median_ms\": " << med << ", \"p95_ms\": " << p95 << ", \"p99_ms\": " << p99
+          << ", \"min_ms\": " << mn << ", \"max_ms\": " << mx << ", \"stddev_ms\": " << sd
+          << ", \"fps\": " << (mean > 0 ? 1000.0 / mean : 0.0) << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    f << "  ]\n}\n";
+    return true;
+}
+
 // ===================== INPUT CALLBACKS =====================
-static void scroll_cb(GLFWwindow*, double /*xoff*/, double yoff) {
+// apply* hold the input logic; the GLFW callbacks below record and forward to them, and
+// replay feeds them from the log instead
+static void applyScroll(double yoff) {
     if (camMode == FREE) {                          // FOV in FREE camera
         fovDeg = glm::clamp(fovDeg - (float)yoff, 20.0f, 90.0f);
         return;
@@ -279,13 +3163,13 @@ static void scroll_cb(GLFWwindow*, double /*xoff*/, double yoff) {
     }
     camDist = glm::clamp(camDist - (float)yoff * 2.0f, 5.0f, 400.0f); // Orbit distance in ORBIT camera
 }
-static void mouse_btn_cb(GLFWwindow* w, int button, int action, int /*mods*/) {
+static void applyMouseButton(int button, int action, double x, double y) {
     if (button == GLFW_MOUSE_BUTTON_RIGHT) {
-        if (action == GLFW_PRESS) { rmbDown = true; glfwGetCursorPos(w, &lastX, &lastY); }
+        if (action == GLFW_PRESS) { rmbDown = true; lastX = x; lastY = y; }
         else rmbDown = false;
     }
 }
-static void cursor_cb(GLFWwindow*, double x, double y) {
+static void applyCursor(double x, double y) {
     if (!rmbDown) return;
     float dx = float(x - lastX), dy = float(y - lastY); lastX = x; lastY = y;
     if (camMode != FREE) {
@@ -297,130 +3181,429 @@ static void cursor_cb(GLFWwindow*, double x, double y) {
         freePitch = glm::clamp(freePitch, glm::radians(-85.0f), glm::radians(85.0f));
     }
 }
-static void key_cb(GLFWwindow* w, int key, int /*sc*/, int action, int mods) {
+static void applyKey(GLFWwindow* w, int key, int action, int mods) {
     if (action != GLFW_PRESS && action != GLFW_REPEAT) return;
     switch (key) {
     case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(w, true); break;
     case GLFW_KEY_F11: toggle_fullscreen(w); break;
+    case GLFW_KEY_F9: captureToggle = true; break;
     case GLFW_KEY_ENTER: if (mods & GLFW_MOD_ALT) toggle_fullscreen(w); break;
 
     case GLFW_KEY_1: camMode = ORBIT; break;
     case GLFW_KEY_2: camMode = FREE;  break;
     case GLFW_KEY_3: camMode = FOCUS; break;
-    case GLFW_KEY_N: focusIndex = (focusIndex + 1) % 9; break;
-    case GLFW_KEY_P: focusIndex = (focusIndex + 8) % 9; break;
+    case GLFW_KEY_N: focusIndex = (focusIndex + 1) % focusCount; break;
+    case GLFW_KEY_P: focusIndex = (focusIndex + focusCount - 1) % focusCount; break;
 
     case GLFW_KEY_H: showOrbits = !showOrbits; std::cout << "Orbit lines: " << (showOrbits ? "ON" : "OFF") << "\n"; break;
-    case GLFW_KEY_B: showStars = !showStars;  std::cout << "Stars: " << (showStars ? "ON" : "OFF") << "\n"; break;
+    case GLFW_KEY_B:
+        starMode = (starMode + 1) % 3;
+        std::cout << "Stars: " << (starMode == STARS_CATALOG ? "catalog" : starMode == STARS_IMAGE ? "image" : "OFF") << "\n";
+        break;
 
     case GLFW_KEY_LEFT_BRACKET:  timeScale = std::max(0.0f, timeScale - 0.25f); std::cout << "timeScale=" << timeScale << "\n"; break;
     case GLFW_KEY_RIGHT_BRACKET: timeScale += 0.25f; std::cout << "timeScale=" << timeScale << "\n"; break;
     case GLFW_KEY_MINUS:  fovDeg = glm::clamp(fovDeg - 1.0f, 20.0f, 90.0f); break;
     case GLFW_KEY_EQUAL:  fovDeg = glm::clamp(fovDeg + 1.0f, 20.0f, 90.0f); break;
 
+    case GLFW_KEY_LEFT:
+    case GLFW_KEY_RIGHT:
+        seekBy += (key == GLFW_KEY_LEFT ? -1.0 : 1.0) * kSeekJump * std::max(1.0f, timeScale) * (mods & GLFW_MOD_SHIFT ? 10.0 : 1.0);
+        break;
+    case GLFW_KEY_HOME: seekHome = true; break;
+    case GLFW_KEY_O:
+        opaqueMode = (opaqueMode + 1) % 3;
+        std::cout << "\nOpaque pass: " << kOpaqueModeNames[opaqueMode] << "\n";
+        break;
+    case GLFW_KEY_G: bloomOn = !bloomOn; std::cout << "\nBloom: " << (bloomOn ? "ON" : "OFF") << "\n"; break;
+    case GLFW_KEY_V: swapInterval = !swapInterval; std::cout << "\nVsync: " << (swapInterval ? "ON" : "OFF") << "\n"; break;
+
     case GLFW_KEY_Z: if (camMode == FOCUS) focusDist = std::max(3.0f, focusDist - 2.0f); break;
     case GLFW_KEY_X: if (camMode == FOCUS) focusDist = std::min(400.0f, focusDist + 2.0f); break;
     }
 }
 
+static void dispatchInput(GLFWwindow* w, const InputEvent& e) {
+    switch (e.type) {
+    case IE_KEY: applyKey(w, e.a, e.b, e.c); break;
+    case IE_MOUSE_BUTTON: applyMouseButton(e.a, e.b, e.x, e.y); break;
+    case IE_CURSOR: applyCursor(e.x, e.y); break;
+    case IE_SCROLL: applyScroll(e.y); break;
+    }
+}
+static void scroll_cb(GLFWwindow*, double /*xoff*/, double yoff) {
+    if (liveInput({ IE_SCROLL, 0, 0, 0, 0.0, yoff })) applyScroll(yoff);
+}
+static void mouse_btn_cb(GLFWwindow* w, int button, int action, int mods) {
+    double x, y; glfwGetCursorPos(w, &x, &y);
+    if (liveInput({ IE_MOUSE_BUTTON, button, action, mods, x, y })) applyMouseButton(button, action, x, y);
+}
+static void cursor_cb(GLFWwindow*, double x, double y) {
+    if (liveInput({ IE_CURSOR, 0, 0, 0, x, y })) applyCursor(x, y);
+}
+static void refresh_cb(GLFWwindow*) { refreshRequested = true; }   // contents lost, e.g. uncovered
+static void key_cb(GLFWwindow* w, int key, int /*sc*/, int action, int mods) {
+    if (inputLog.mode == INPUT_REPLAY && key == GLFW_KEY_ESCAPE) glfwSetWindowShouldClose(w, true); // always a way out
+    if (liveInput({ IE_KEY, key, action, mods, 0.0, 0.0 })) applyKey(w, key, action, mods);
+}
+
 // ===================== MAIN =====================
-int main() {
+int main(int argc, char** argv) {
+    threadSlot(); // main thread is T0 in the startup timeline
     open_console();
     print_controls();
 
+    bool benchMode = false;
+    std::string benchOnly, benchOut = "bench_results.json";
+    std::string scenePath = "scenes/solar.scene";
+    std::string starCatalog;                        // CSV; empty for the generated sky
+    bool ephemMode = false;
+    double ephemStartJd = julianDateNow();
+    RenderScale renderScale;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rebake-meshes") rebakeMeshes = true;
+        else if (arg == "--bench") { benchMode = true; if (i + 1 < argc && argv[i + 1][0] != '-') benchOnly = argv[++i]; }
+        else if (arg == "--bench-out" && i + 1 < argc) benchOut = argv[++i];
+        else if (arg == "--no-vt") vtEnabled = false;
+        else if (arg == "--no-bloom") bloomOn = false;
+        else if (arg == "--no-vsync") swapInterval = 0;
+        else if (arg == "--no-idle") renderOnDemand = false;
+        else if (arg == "--fps-cap" && i + 1 < argc) fpsCap = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--paused-fps" && i + 1 < argc) pausedFps = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--opaque" && i + 1 < argc) {
+            std::string m = argv[++i];
+            opaqueMode = (int)(std::find(kOpaqueModeNames, kOpaqueModeNames + 3, m) - kOpaqueModeNames);
+            if (opaqueMode == 3) { std::cerr << "Bad --opaque mode " << m << " (scene, sorted or prepass)\n"; return -1; }
+        }
+        else if (arg == "--scene" && i + 1 < argc) scenePath = argv[++i];
+        else if (arg == "--star-catalog" && i + 1 < argc) starCatalog = argv[++i];
+        else if (arg == "--ephemeris") {
+            ephemMode = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                std::istringstream ds(argv[++i]);
+                int y = 0, m = 0, d = 0; char dash1 = 0, dash2 = 0;
+                if (!(ds >> y >> dash1 >> m >> dash2 >> d) || dash1 != '-' || dash2 != '-') {
+                    std::cerr << "Bad --ephemeris date " << argv[i] << " (expected YYYY-MM-DD)\n"; return -1;
+                }
+                ephemStartJd = julianDate(y, m, d);
+            }
+        }
+        else if (arg == "--record" && i + 1 < argc) { if (!inputStartRecording(argv[++i])) return -1; }
+        else if (arg == "--replay" && i + 1 < argc) { if (!inputStartReplay(argv[++i])) return -1; }
+        else if (arg == "--gpu-budget-mb" && i + 1 < argc) gpuBudgetBytes = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        else if (arg == "--render-scale" && i + 1 < argc) {
+            renderScale.scale = glm::clamp((float)std::atof(argv[++i]), 0.25f, 1.0f);
+            renderScale.dynamic = false;
+        }
+        else if (arg == "--target-fps" && i + 1 < argc) renderScale.budgetMs = 1000.0 / std::max(1.0, std::atof(argv[++i]));
+        else std::cerr << "Unknown option: " << arg << "\n";
+    }
+    double ephemJd = ephemStartJd;
+
+    // ---- scene: bodies, rings and the sky come from the compiled scene file ----
+    Scene scene;
+    if (!loadScene(scenePath, scene)) return -1;
+    const uint32_t bodyCount = scene.h->bodyCount, ringCount = scene.h->ringCount;
+
+    // ---- startup task graph: CPU-only work runs on the pool while the GL context comes up ----
+    unsigned hw = std::thread::hardware_concurrency();
+    TaskPool pool(hw > 1 ? hw - 1 : 1);
+    std::future<bool> fEphem;
+    if (ephemMode) fEphem = pool.submit([] { return ensureEphemeris(kEphemPath); });
+
+    // one unit mesh per sphere lattice; bodies share them and differ only in Mesh::scale
+    auto sphereTask = [&](int stacks, int slices) { return pool.submit([=] { return prepareSphere(stacks, slices); }); };
+    std::future<MeshData> fLod96 = sphereTask(48, 96), fLod88 = sphereTask(44, 88), fLod80 = sphereTask(40, 80);
+    std::future<MeshData> fLod64 = sphereTask(32, 64), fLod56 = sphereTask(28, 56), fLod48 = sphereTask(24, 48);
+    std::vector<std::future<MeshData>> fRings;
+    for (uint32_t i = 0; i < ringCount; ++i) {
+        float inner = scene.rings[i].inner, outer = scene.rings[i].outer;
+        fRings.push_back(pool.submit([inner, outer] { return prepareRing(256, inner, outer); }));
+    }
+    std::future<MeshData> fHud = pool.submit([] { return prepareOrbitLine(128, 1.0f); }); // unit circle; scaled in 2D
+    // one line per distinct orbit around a root body; moons get none, ephemeris planets trace their ellipse
+    auto hasOrbitLine = [&](const SceneBodyRecord& b) {
+        return b.parent >= 0 && scene.bodies[b.parent].parent < 0 && !(b.flags & SB_NO_ORBIT_LINE) && b.orbitRadius > 0.0f;
+    };
+    std::vector<std::pair<float, float>> orbitShapes;           // (semi-major axis, eccentricity)
+    for (uint32_t i = 0; i < bodyCount; ++i) {
+        const SceneBodyRecord& b = scene.bodies[i];
+        if (hasOrbitLine(b) && !(ephemMode && planetElements(scene.str(b.name)))) orbitShapes.emplace_back(b.orbitRadius, b.eccentricity);
+    }
+    std::sort(orbitShapes.begin(), orbitShapes.end());
+    orbitShapes.erase(std::unique(orbitShapes.begin(), orbitShapes.end()), orbitShapes.end());
+    std::vector<std::future<MeshData>> fOrbits;
+    for (const auto& o : orbitShapes) fOrbits.push_back(pool.submit([o] { return prepareOrbitLine(256, o.first, o.second); }));
+
+    // textures: each distinct path is decoded once, however many bodies share it. Virtual-textured
+    // bodies stream theirs, so a map is only decoded when something needs it fully resident.
+    std::vector<std::string> texPaths;
+    std::vector<char> texResident;
+    std::unordered_map<std::string, int> texSlot;
+    auto texSlotFor = [&](const std::string& path, bool resident) {
+        auto it = texSlot.emplace(path, (int)texPaths.size());
+        if (it.second) { texPaths.push_back(path); texResident.push_back(0); }
+        texResident[it.first->second] |= resident;
+        return it.first->second;
+    };
+    auto texIndex = [&](uint32_t off, bool resident) { return off == kSceneNoString ? -1 : texSlotFor(scene.str(off), resident); };
+    std::vector<int> bodyTex(bodyCount), ringTex(ringCount);
+    for (uint32_t i = 0; i < bodyCount; ++i)
+        bodyTex[i] = texIndex(scene.bodies[i].texture, !(vtEnabled && (scene.bodies[i].flags & SB_VIRTUAL_TEXTURE)));
+    for (uint32_t i = 0; i < ringCount; ++i) ringTex[i] = texIndex(scene.rings[i].texture, true);
+    int beltTex = benchMode ? texSlotFor(kBeltTexture, true) : -1;   // rocks keep the workload earlier runs measured
+    std::string skyPath = scene.str(scene.h->skyTexture);
+    std::future<bool> fSky;
+    std::string starPath = starCatalog.empty() ? kGeneratedStarPath : cachePath(starCatalog, "stars", ".sst");
+    std::future<bool> fStars = pool.submit([starCatalog, starPath] { return ensureStarCatalog(starCatalog, starPath); });
+    if (!skyPath.empty()) fSky = pool.submit([skyPath] { return ensureSkyboxCache(skyPath.c_str(), cachePath(skyPath, "sky", ".sky")); });
+
+    // one virtual texture cache per distinct map; the full-size image is only decoded when it needs baking
+    std::vector<std::future<bool>> fVt(texPaths.size());
+    if (vtEnabled) {
+        for (uint32_t i = 0; i < bodyCount; ++i) {
+            int t = bodyTex[i];
+            if (t < 0 || !(scene.bodies[i].flags & SB_VIRTUAL_TEXTURE) || fVt[t].valid()) continue;
+            std::string src = texPaths[t];
+            fVt[t] = pool.submit([src] { return ensureVirtualTextureCache(src.c_str(), vtCachePath(src)); });
+        }
+    }
+    std::vector<std::future<ImageData>> fImages;
+    for (size_t i = 0; i < texPaths.size(); ++i) {
+        std::string path = texPaths[i];
+        bool skip = !texResident[i];
+        fImages.push_back(pool.submit([path, skip] { return skip ? ImageData{} : decodeImage(path.c_str()); }));
+    }
+
+    std::unique_ptr<TimelineScope> tsContext(new TimelineScope("GL context + GLEW"));
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_DEPTH_BITS, 0);             // the scene has its own depth buffer, see HDR POST
+    if (benchMode) { glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); winW = kBenchW; winH = kBenchH; }
 
     GLFWwindow* win = glfwCreateWindow(winW, winH, "Solar System", nullptr, nullptr);
     if (!win) { glfwTerminate(); return -1; }
     glfwMakeContextCurrent(win);
+    int appliedSwapInterval = benchMode ? 0 : swapInterval;
+    glfwSwapInterval(appliedSwapInterval);
 
     // --- Important for core profile + GLEW ---
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) { std::cerr << "GLEW init failed\n"; return -1; }
     glGetError(); // swallow benign error from GLEW in core profile
+    tsContext.reset();
 
     glfwSetScrollCallback(win, scroll_cb);
     glfwSetMouseButtonCallback(win, mouse_btn_cb);
     glfwSetCursorPosCallback(win, cursor_cb);
     glfwSetKeyCallback(win, key_cb);
+    glfwSetWindowRefreshCallback(win, refresh_cb);
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
-    GLuint prog = makeProgram(vsSrc, fsSrc);
+    std::unique_ptr<TimelineScope> tsShaders(new TimelineScope("compile shaders"));
     GLuint lineProg = makeProgram(vsLine, fsLine);
+    GLuint fbProg = makeProgram(vsSrc, withGlsl(fsVtFeedback, vtGlsl).c_str());
+    GLuint depthProg = makeProgram(vsSrc, fsDepth);
+    GLuint skyProg = makeProgram(vsSky, fsSky);
+    GLuint starProg = makeProgram(vsStars, fsStars);
+    HdrPost post;
+    hdrPostInit(post);
+    tsShaders.reset();
+
+    // lit programs are compiled per material on first use (or restored from shaders/)
+    ShaderVariants litVariants;
+    shaderVariantsInit(litVariants);
+    VtUniforms fbVtU = vtUniforms(fbProg);
+    GLint uFbModel = glGetUniformLocation(fbProg, "model"), uFbView = glGetUniformLocation(fbProg, "view");
+    GLint uFbProj = glGetUniformLocation(fbProg, "projection"), uFbId = glGetUniformLocation(fbProg, "vtId");
+
+    // batched GL uploads: wait on each CPU task and hand its bytes to GL
+    Mesh lod96, lod88, lod80, lod64, lod56, lod48, hudCircle;
+    std::vector<Mesh> orbitLines, ringMeshes;
+    {
+        TimelineScope ts("upload meshes");
+        lod96 = uploadMeshData(fLod96.get()); lod88 = uploadMeshData(fLod88.get());
+        lod80 = uploadMeshData(fLod80.get()); lod64 = uploadMeshData(fLod64.get());
+        lod56 = uploadMeshData(fLod56.get()); lod48 = uploadMeshData(fLod48.get());
+        for (std::future<MeshData>& f : fRings) ringMeshes.push_back(uploadMeshData(f.get()));
+        hudCircle = uploadMeshData(fHud.get());
+        for (std::future<MeshData>& f : fOrbits) orbitLines.push_back(uploadMeshData(f.get()));
+    }
+    // lattice density follows body size
+    auto sphereFor = [&](float r) {
+        return withScale(r >= 2.0f ? lod96 : r >= 1.2f ? lod88 : r >= 0.9f ? lod80 : r >= 0.5f ? lod64 : lod56, r);
+    };
 
-    // uniforms
-    GLint uModel = glGetUniformLocation(prog, "model");
-    GLint uView = glGetUniformLocation(prog, "view");
-    GLint uProj = glGetUniformLocation(prog, "projection");
-    GLint uLightPos = glGetUniformLocation(prog, "lightPos");
-    GLint uLightColor = glGetUniformLocation(prog, "lightColor");
-    GLint uViewPos = glGetUniformLocation(prog, "viewPos");
-    GLint uUseTex = glGetUniformLocation(prog, "useTexture");
-    GLint uBase = glGetUniformLocation(prog, "baseColor");
-    GLint uEmis = glGetUniformLocation(prog, "emissive");
-    GLint uSh = glGetUniformLocation(prog, "shininess");
-    GLint uKs = glGetUniformLocation(prog, "ks");
-    glUseProgram(prog);
-    glUniform1i(glGetUniformLocation(prog, "albedo"), 0);
-
-    // geometry
-    Mesh sunMesh = buildSphere(48, 96, 2.8f);
-    Mesh earthMesh = buildSphere(40, 80, 1.0f);
-    Mesh smallMesh = buildSphere(32, 64, 0.6f);
-    Mesh tinyMesh = buildSphere(28, 56, 0.35f);
-    Mesh bigMesh = buildSphere(48, 96, 2.0f);
-    Mesh ringMesh = buildRing(256, 1.8f, 3.2f);
-    Mesh skyMesh = buildSphere(24, 48, 300.0f);
-    Mesh hudCircle = buildOrbitLine(128, 1.0f); // unit circle; scaled in 2D
-
-    std::vector<Mesh> orbitLines = {
-        buildOrbitLine(256, 6.0f),  buildOrbitLine(256, 9.0f),
-        buildOrbitLine(256,12.0f), buildOrbitLine(256,15.0f),
-        buildOrbitLine(256,20.0f), buildOrbitLine(256,26.0f),
-        buildOrbitLine(256,32.0f), buildOrbitLine(256,38.0f)
+    std::vector<GLuint> tex(texPaths.size());
+    {
+        TimelineScope ts("upload textures");
+        for (size_t i = 0; i < texPaths.size(); ++i) tex[i] = uploadTexture2D(fImages[i].get());
+    }
+    VtSystem vts;
+    std::vector<int> texVt(texPaths.size(), -1);
+    if (vtEnabled) {
+        vtInit(vts);
+        for (size_t i = 0; i < texPaths.size(); ++i) {
+            if (!fVt[i].valid()) continue;
+            if (fVt[i].get()) texVt[i] = vtOpen(vts, vtCachePath(texPaths[i]));
+            if (texVt[i] < 0) {
+                std::cerr << "Virtual texture unavailable, loading " << texPaths[i] << " resident\n";
+                if (!tex[i]) tex[i] = uploadTexture2D(decodeImage(texPaths[i].c_str()));
+            }
+        }
+    }
+    // every body texture is managed; the sky cubemap is not, it fills the screen at full size
+    ResidencyManager residency;
+    FrameCapture capture;
+    for (size_t i = 0; i < texPaths.size(); ++i)
+        residencyTrack(residency, tex[i], texPaths[i].c_str());
+    GLuint skyCube = fSky.valid() && fSky.get() ? uploadSkybox(cachePath(skyPath, "sky", ".sky")) : 0;
+    if (!skyPath.empty() && !skyCube) std::cerr << "Sky unavailable: " << skyPath << "\n";
+    GLuint skyVao; glGenVertexArrays(1, &skyVao);   // the sky triangle has no vertex data
+    StarField starField;
+    if (!fStars.get() || !starFieldLoad(starField, starPath)) std::cerr << "Star catalog unavailable, using the sky image\n";
+    uint32_t starsDrawn = 0;
+
+    // bodies in scene order, so every parent precedes its children
+    std::vector<Planet> bodies(bodyCount);
+    std::vector<int> focusBodies;                   // N/P cycle: the roots and what orbits them directly
+    for (uint32_t i = 0; i < bodyCount; ++i) {
+        const SceneBodyRecord& r = scene.bodies[i];
+        Planet& b = bodies[i];
+        b.mesh = sphereFor(r.radius);
+        if (bodyTex[i] >= 0) {
+            b.tex = tex[bodyTex[i]];
+            if (r.flags & SB_VIRTUAL_TEXTURE) b.vt = texVt[bodyTex[i]];
+        }
+        b.orbitRadius = r.orbitRadius; b.orbitSpeed = r.orbitSpeed; b.spinSpeed = r.spinSpeed;
+        b.orbitAngle = r.orbitAngle; b.spinAngle = r.spinAngle; b.eccentricity = r.eccentricity;
+        b.parent = r.parent;
+        b.mat.base = glm::make_vec3(r.base); b.mat.emissive = glm::make_vec3(r.emissive);
+        b.mat.shininess = r.shininess; b.mat.ks = r.ks;
+        if (r.parent < 0 || scene.bodies[r.parent].parent < 0) focusBodies.push_back((int)i);
+    }
+    focusCount = (int)focusBodies.size();
+    std::vector<Ring> rings(ringCount);
+    for (uint32_t i = 0; i < ringCount; ++i) {
+        const SceneRingRecord& r = scene.rings[i];
+        rings[i].mesh = ringMeshes[i];
+        rings[i].tex = ringTex[i] >= 0 ? tex[ringTex[i]] : 0;
+        rings[i].parent = r.parent; rings[i].tilt = r.tilt; rings[i].outer = r.outer;
+        rings[i].mat.shininess = r.shininess; rings[i].mat.ks = r.ks;
+    }
+    std::vector<glm::mat4> bodyFrame, bodyWorld;
+
+    // eclipses: the light's disc is the body carrying the scene's first light (the emissive root if the
+    // scene has none); receivers are the bodies, then one sphere per ring
+    int lightBody = scene.h->lightCount ? scene.lights[0].parent : -1;   // drawn unlit: the light sits inside it
+    for (size_t i = 0; i < bodies.size() && lightBody < 0; ++i)
+        if (bodies[i].parent < 0 && bodies[i].mat.emissive != glm::vec3(0.0f)) lightBody = (int)i;
+    float lightRadius = lightBody >= 0 ? bodies[lightBody].mesh.scale : 1.0f;
+    Eclipses eclipses;
+    std::vector<glm::vec3> shadowCenter(bodyCount + ringCount);
+    std::vector<float> shadowRadius(bodyCount + ringCount);
+
+    LightClusters clusters;
+    lightClustersInit(clusters);
+    std::vector<PointLight> pointLights;
+
+    std::vector<size_t> opaqueOrder(bodyCount);
+    FragmentCounter shadedFragments;
+    fragmentCounterInit(shadedFragments);
+
+    // ephemeris mode: bodies the file names follow it, scaled so their mean distance lands on the scene orbit
+    Ephemeris ephem;
+    std::vector<glm::vec3> ephemPos;
+    if (ephemMode) {
+        if (!fEphem.get() || !mapEphemeris(kEphemPath, ephem)) {
+            std::cerr << "Cannot load ephemeris " << kEphemPath << "\n"; glfwTerminate(); return -1;
+        }
+        ephemPos.resize(bodyCount);
+        for (uint32_t i = 0; i < bodyCount; ++i) {
+            const SceneBodyRecord& r = scene.bodies[i];
+            Planet& b = bodies[i];
+            b.ephem = ephemerisBody(ephem, scene.str(r.name));
+            if (b.ephem < 0 || ephem.bodies[b.ephem].a <= 0.0) { b.ephem = -1; continue; }
+            b.ephemScale = b.orbitRadius / (float)ephem.bodies[b.ephem].a;
+            const KeplerElements* k = planetElements(scene.str(r.name));
+            if (k && hasOrbitLine(r)) orbitLines.push_back(ephemerisOrbitLine(*k, ephemJd, b.ephemScale));
+        }
+        std::cout << "Ephemeris " << calendarDate(ephem.h->startJd) << " .. "
+                  << calendarDate(ephem.h->startJd + ephem.h->segmentCount * ephem.h->segmentDays)
+                  << ", starting " << calendarDate(ephemJd) << "\n";
+    }
+
+    // everything the simulation carries from frame to frame; replay compares it against the log
+    auto stateHash = [&]() {
+        float cam[] = { camYaw, camPitch, camDist, freePos.x, freePos.y, freePos.z, freeYaw, freePitch,
+                        fovDeg, focusDist, timeScale, (float)camMode, (float)focusIndex, (float)paused };
+        uint64_t h = fnv1a(cam, sizeof(cam));
+        for (const Planet& p : bodies) {
+            float a[] = { p.orbitAngle, p.spinAngle };
+            h = fnv1a(a, sizeof(a), h);
+        }
+        if (ephemMode) h = fnv1a(&ephemJd, sizeof(ephemJd), h);
+        return h;
     };
 
-    // textures (put images in ./textures/)
-    GLuint texSun = loadTexture2D("textures/sun.jpg");
-    GLuint texMercury = loadTexture2D("textures/mercury.jpg");
-    GLuint texVenus = loadTexture2D("textures/venus.jpg");
-    GLuint texEarth = loadTexture2D("textures/earth_day.jpg");
-    GLuint texMoon = loadTexture2D("textures/moon.jpg");
-    GLuint texMars = loadTexture2D("textures/mars.jpg");
-    GLuint texJupiter = loadTexture2D("textures/jupiter.jpg");
-    GLuint texSaturn = loadTexture2D("textures/saturn.jpg");
-    GLuint texRing = loadTexture2D("textures/saturnRing.png");
-    GLuint texUranus = loadTexture2D("textures/uranus.jpg");
-    GLuint texNeptune = loadTexture2D("textures/neptune.jpg");
-    GLuint texStars = loadTexture2D("textures/stars.jpg");
-
-    // planets
-    Planet sun{ sunMesh,  texSun,     0,  0, 10 };
-    Planet mercury{ tinyMesh, texMercury, 6, 48,  6 };
-    Planet venus{ smallMesh,texVenus,   9, 35, -2 };
-    Planet earth{ earthMesh,texEarth,  12, 30, 50 };
-    Planet moon{ tinyMesh, texMoon,    2, 80, 20 };
-    Planet mars{ smallMesh,texMars,   15, 24, 40 };
-    Planet jupiter{ bigMesh,  texJupiter,20, 13, 80 };
-    Planet saturn{ bigMesh,  texSaturn, 26, 10, 70 };
-    Planet uranus{ buildSphere(44,88,1.3f),  texUranus, 32, 7, 50 };
-    Planet neptune{ buildSphere(44,88,1.25f), texNeptune,38, 5, 40 };
-
-    // Second moon: Europa around Jupiter
-    Planet europa{ tinyMesh, texMoon /*swap if you have europa texture*/, 3.0f, 90.0f, 15.0f };
+    // benchmark: scenarios render into an offscreen target; everything else draws to the window
+    std::vector<BenchScenario> scenarios;
+    std::vector<BenchResult> benchResults;
+    size_t benchIndex = 0; int benchFrame = 0; float benchTime = 0.0f; double benchLast = 0.0;
+    GLuint mainFbo = 0;
+    std::vector<BeltRock> belt;
+    int beltLights = 0;                             // benchmark beacons riding on belt rocks
+    std::vector<glm::vec2> initialAngles;
+    for (const Planet& p : bodies) initialAngles.push_back(glm::vec2(p.orbitAngle, p.spinAngle));
+    Timeline timeline;
+    timelineReset(timeline, bodies, ephemJd);
+    int substeps = 0;
+    auto startScenario = [&](const BenchScenario& sc) {
+        for (size_t i = 0; i < bodies.size(); ++i) { bodies[i].orbitAngle = initialAngles[i].x; bodies[i].spinAngle = initialAngles[i].y; }
+        ephemJd = ephemStartJd;
+        timelineReset(timeline, bodies, ephemJd);
+        belt = makeBelt(sc.beltRocks);
+        beltLights = std::min(sc.beltLights, sc.beltRocks);
+        paused = false; timeScale = 1.0f; benchFrame = 0; benchTime = 0.0f;
+        benchResults.push_back({ sc.name, {} });
+        std::cout << "\nBenchmark: " << sc.name << " (" << sc.duration << " s, " << sc.beltRocks << " belt rocks, " << sc.beltLights << " lights)" << std::flush;
+    };
+    if (benchMode) {
+        for (const BenchScenario& sc : benchScenarios())
+            if (benchOnly.empty() || sc.name == benchOnly) scenarios.push_back(sc);
+        if (scenarios.empty()) { std::cerr << "No benchmark scenario named " << benchOnly << "\n"; glfwTerminate(); return -1; }
+        renderScale.dynamic = false;                // runs compare at a fixed resolution (--render-scale sets it)
+        GLuint color;                               // the tonemap target; the scene draws into HdrPost
+        glGenFramebuffers(1, &mainFbo); glGenTextures(1, &color);
+        glBindTexture(GL_TEXTURE_2D, color);
+        gpuTexImage2D(0, GL_RGBA8, kBenchW, kBenchH, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, mainFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        startScenario(scenarios[0]);
+    }
 
     float last = (float)glfwGetTime();
     bool prevSpace = false;
+    bool firstFrame = true;
+    uint64_t frameIndex = 0;
+    FramePacer pacer;
+    uint64_t lastSignature = 0;
+    int stableFrames = 0;
+    bool idle = false;
 
     // ===== FPS state =====
     double fpsAccum = 0.0;
     int    fpsFrames = 0;
+    int    readouts = 0;       // the detail block goes out every kReadoutDetailEvery of them
     double fpsValue = 0.0;     // refreshed every 0.5s
 
     // Make console pretty numbers
@@ -428,11 +3611,15 @@ int main() {
     std::cout << std::setprecision(1);
 
     while (!glfwWindowShouldClose(win)) {
-        float now = (float)glfwGetTime();
+        double frameStart = glfwGetTime();
+        float now = (float)frameStart;
         float dt = now - last; last = now;
+        float wallDt = dt;                          // dt itself may come from a replay log
+        if (!inputBeginFrame(win, dt)) break;
+        if (benchMode) { dt = kBenchStep; winW = kBenchW; winH = kBenchH; }
 
         // ===== FPS accumulate & print to CMD =====
-        fpsAccum += dt;
+        fpsAccum += wallDt;
         fpsFrames += 1;
         if (fpsAccum >= 0.5) {                     // print twice per second
             fpsValue = fpsFrames / fpsAccum;
@@ -444,42 +3631,100 @@ int main() {
             std::snprintf(title, sizeof(title), "Solar System  |  FPS: %.1f", fpsValue);
             glfwSetWindowTitle(win, title);
 
-            // Print one-line live readout in console (overwrites same line)
+            // Print one-line live readout in console (overwrites same line); it must fit one terminal row,
+            // or the \r only rewinds the wrapped tail
             std::cout << "\rFPS: " << fpsValue
                 << " | Mode: " << (camMode == ORBIT ? "Orbit" : camMode == FREE ? "Free" : "Focus")
                 << " | FocusDist: " << focusDist
-                << " | FOV: " << fovDeg
-                << "          " << std::flush;
+                << " | FOV: " << fovDeg;
+            std::cout << " | t: " << timeline.t << " s";
+            if (idle) std::cout << " | Idle";
+            if (capture.active) std::cout << " | REC " << capture.enc.written;
+            std::cout << "          " << std::flush;
+
+            // the detail goes out as its own block every few seconds, formatted apart from the live line's precision
+            if (++readouts % kReadoutDetailEvery == 0) {
+                framePacerReport(pacer);
+                std::ostringstream d;
+                d << std::fixed << std::setprecision(2);
+                d << "\n  Sim: " << substeps << " substeps";
+                if (ephemMode) d << ", date " << calendarDate(ephemJd);
+                if (eclipses.shadowed) d << ", " << eclipses.shadowed << " eclipsed";
+                d << "\n  Draw: " << litVariants.programs.size() << " shaders (" << litVariants.cached << " cached)";
+                if (starsDrawn) d << ", " << starsDrawn << " stars";
+                if (clusters.lights) d << ", " << clusters.lights << " clustered lights (" << clusters.references << " refs)";
+                if (shadedFragments.lastMode >= 0)
+                    d << ", " << shadedFragments.last / 1e6 << "M frags shaded (" << kOpaqueModeNames[shadedFragments.lastMode] << ")";
+                d << "\n  Frame: " << pacer.meanMs << " ms +/- " << pacer.jitterMs << " (worst " << pacer.worstMs << ")"
+                  << (appliedSwapInterval ? ", vsync" : "");
+                if (paused && pausedFps > 0.0) d << ", low power";
+                else if (fpsCap > 0.0) d << ", cap " << fpsCap;
+                d << ", scale " << renderScale.scale << " (" << post.w << "x" << post.h << (renderScale.dynamic ? ", auto" : "") << ")";
+                d << "\n  GPU time: scene " << post.ms[POST_SCENE] << ", bloom " << post.ms[POST_BLOOM_DOWN] << "+"
+                  << post.ms[POST_BLOOM_UP] << ", tonemap " << post.ms[POST_TONEMAP] << " ms";
+                d << "\n  Memory: " << toMB(gpuUsedBytes()) << "/" << toMB(gpuBudgetBytes) << " MB (tex " << toMB(gpuTextureBytes)
+                  << ", buf " << toMB(gpuBufferBytes) << "), " << residency.evictions << " mip drops, " << residency.restores << " restores";
+                if (!vts.vts.empty())
+                    d << "; VT " << vts.residentCount << "/" << kVtPoolPages * kVtPoolPages << " pages, "
+                      << vts.loadsTotal << " loads, " << vts.evictions << " evictions";
+                if (capture.active) d << "\n  Capture: " << capture.enc.written << " frames, " << capture.dropped << " dropped";
+                std::cout << d.str() << "\n";
+            }
         }
 
         // spacebar pause (edge-detected)
-        int sp = glfwGetKey(win, GLFW_KEY_SPACE);
-        if (sp == GLFW_PRESS && !prevSpace) {
+        bool sp = keyDown(GLFW_KEY_SPACE);
+        if (sp && !prevSpace) {
             paused = !paused;
             std::cout << (paused ? "\nPaused\n" : "\nRunning\n");
         }
-        prevSpace = (sp == GLFW_PRESS);
+        prevSpace = sp;
 
         // keyboard nudge for orbit cam
-        if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS && camMode != FREE) camYaw -= 0.04f;
-        if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS && camMode != FREE) camYaw += 0.04f;
-        if (glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS && camMode != FREE) camPitch += 0.03f;
-        if (glfwGetKey(win, GLFW_KEY_E) == GLFW_PRESS && camMode != FREE) camPitch -= 0.03f;
+        if (keyDown(GLFW_KEY_A) && camMode != FREE) camYaw -= 0.04f;
+        if (keyDown(GLFW_KEY_D) && camMode != FREE) camYaw += 0.04f;
+        if (keyDown(GLFW_KEY_Q) && camMode != FREE) camPitch += 0.03f;
+        if (keyDown(GLFW_KEY_E) && camMode != FREE) camPitch -= 0.03f;
 
         float adv = paused ? 0.0f : (dt * timeScale);
 
         // animate
-        sun.spinAngle += sun.spinSpeed * adv;
-        mercury.orbitAngle += mercury.orbitSpeed * adv; mercury.spinAngle += mercury.spinSpeed * adv;
-        venus.orbitAngle += venus.orbitSpeed * adv;   venus.spinAngle += venus.spinSpeed * adv;
-        earth.orbitAngle += earth.orbitSpeed * adv;   earth.spinAngle += earth.spinSpeed * adv;
-        moon.orbitAngle += moon.orbitSpeed * adv;    moon.spinAngle += moon.spinSpeed * adv;
-        mars.orbitAngle += mars.orbitSpeed * adv;    mars.spinAngle += mars.spinSpeed * adv;
-        jupiter.orbitAngle += jupiter.orbitSpeed * adv; jupiter.spinAngle += jupiter.spinSpeed * adv;
-        saturn.orbitAngle += saturn.orbitSpeed * adv;  saturn.spinAngle += saturn.spinSpeed * adv;
-        uranus.orbitAngle += uranus.orbitSpeed * adv;  uranus.spinAngle += uranus.spinSpeed * adv;
-        neptune.orbitAngle += neptune.orbitSpeed * adv; neptune.spinAngle += neptune.spinSpeed * adv;
-        europa.orbitAngle += europa.orbitSpeed * adv;  europa.spinAngle += europa.spinSpeed * adv;
+        substeps = simulate(bodies, ephemJd, adv);
+        timeline.t += adv;
+        timelineRecord(timeline, bodies, ephemJd);
+        if (seekBy != 0.0 || seekHome) {
+            timelineSeek(timeline, bodies, ephemJd, seekHome ? 0.0 : timeline.t + seekBy);
+            std::cout << "\nSeek to t=" << timeline.t << " s (" << timeline.seekMs << " ms, "
+                      << timeline.times.size() << " checkpoints every " << timeline.interval << " s)\n";
+            seekBy = 0.0; seekHome = false;
+        }
+        if (ephemMode) {
+            ephemerisEval(ephem, ephemJd);
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                int e = bodies[i].ephem;
+                if (e >= 0) ephemPos[i] = eclipticToScene(ephem.x[e], ephem.y[e], ephem.z[e], bodies[i].ephemScale);
+            }
+        }
+        bodyTransforms(bodies, ephemPos, bodyFrame, bodyWorld);
+        for (size_t i = 0; i < bodies.size(); ++i) { shadowCenter[i] = glm::vec3(bodyWorld[i][3]); shadowRadius[i] = bodies[i].mesh.scale; }
+        for (size_t i = 0; i < rings.size(); ++i) {
+            shadowCenter[bodies.size() + i] = glm::vec3(bodyFrame[rings[i].parent][3]);
+            shadowRadius[bodies.size() + i] = rings[i].outer;
+        }
+        // lights: the scene's first is the primary (the emissive root if it has none), the rest are clustered;
+        // eclipses are cast from the primary
+        glm::vec3 primaryPos = lightBody >= 0 ? glm::vec3(bodyFrame[lightBody][3]) : glm::vec3(0.0f), primaryColor(7.0f);
+        pointLights.clear();
+        for (uint32_t i = 0; i < scene.h->lightCount; ++i) {
+            const SceneLightRecord& l = scene.lights[i];
+            glm::vec3 pos(bodyFrame[l.parent] * glm::vec4(glm::make_vec3(l.offset), 1.0f));
+            if (i == 0) { primaryPos = pos; primaryColor = glm::make_vec3(l.color); }
+            else pointLights.push_back({ pos, l.range, glm::make_vec3(l.color) });
+        }
+        findEclipses(eclipses, shadowCenter, shadowRadius, bodies.size(), primaryPos, lightRadius);
+
+        if (benchMode) { benchApplyCamera(scenarios[benchIndex].keys, benchTime); benchTime += kBenchStep; }
+        for (BeltRock& r : belt) r.angle += r.speed * adv;
 
         // camera build
         glm::vec3 eye, target(0, 0, 0), up(0, 1, 0);
@@ -487,11 +3732,7 @@ int main() {
             eye = orbitCamPos();
         }
         else if (camMode == FOCUS) {
-            Planet* arr[9] = { &sun,&mercury,&venus,&earth,&mars,&jupiter,&saturn,&uranus,&neptune };
-            Planet* f = arr[std::max(0, std::min(8, focusIndex))];
-            glm::vec3 p(f->orbitRadius * cosf(glm::radians(f->orbitAngle)),
-                0.0f,
-                f->orbitRadius * sinf(glm::radians(f->orbitAngle)));
+            glm::vec3 p(bodyWorld[focusBodies[std::max(0, std::min(focusCount - 1, focusIndex))]][3]);
             target = p;
             float cp = cosf(camPitch), spv = sinf(camPitch), sy = sinf(camYaw), cy = cosf(camYaw);
             glm::vec3 offset(focusDist * cp * sy, focusDist * spv, focusDist * cp * cy);
@@ -501,12 +3742,12 @@ int main() {
             const float move = (rmbDown ? 25.0f : 8.0f) * dt;
             glm::vec3 fwd(sinf(freeYaw), 0, -cosf(freeYaw));
             glm::vec3 right = glm::normalize(glm::cross(fwd, glm::vec3(0, 1, 0)));
-            if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS) freePos += fwd * move;
-            if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS) freePos -= fwd * move;
-            if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS) freePos -= right * move;
-            if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS) freePos += right * move;
-            if (glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS) freePos.y += move;
-            if (glfwGetKey(win, GLFW_KEY_E) == GLFW_PRESS) freePos.y -= move;
+            if (keyDown(GLFW_KEY_W)) freePos += fwd * move;
+            if (keyDown(GLFW_KEY_S)) freePos -= fwd * move;
+            if (keyDown(GLFW_KEY_A)) freePos -= right * move;
+            if (keyDown(GLFW_KEY_D)) freePos += right * move;
+            if (keyDown(GLFW_KEY_Q)) freePos.y += move;
+            if (keyDown(GLFW_KEY_E)) freePos.y -= move;
             glm::vec3 dir(cosf(freePitch) * sinf(freeYaw), sinf(freePitch), -cosf(freePitch) * cosf(freeYaw));
             eye = freePos; target = freePos + dir;
         }
@@ -515,131 +3756,184 @@ int main() {
         camDist = glm::clamp(camDist, 5.0f, 400.0f);
 
         glm::mat4 view = glm::lookAt(eye, target, up);
-        glm::mat4 proj = glm::perspective(glm::radians(fovDeg), (float)winW / winH, 0.1f, 1000.0f);
+        const float nearZ = 0.1f, farZ = 1000.0f;
+        glm::mat4 proj = glm::perspective(glm::radians(fovDeg), (float)winW / winH, nearZ, farZ);
+
+        // render on demand: skip the frame when its image would repeat the one on screen
+        int looks[] = { winW, winH, (int)showOrbits, starMode, opaqueMode, (int)bloomOn,
+                        vts.loadsTotal, vts.residentCount, residency.evictions, residency.restores };
+        double clocks[] = { timeline.t, ephemJd, (double)renderScale.scale };
+        uint64_t signature = fnv1a(clocks, sizeof(clocks), fnv1a(looks, sizeof(looks), fnv1a(glm::value_ptr(view), sizeof(view), stateHash())));
+        stableFrames = signature == lastSignature ? stableFrames + 1 : 0;
+        lastSignature = signature;
+        idle = renderOnDemand && !benchMode && inputLog.mode == INPUT_LIVE && !capture.active && !captureToggle
+            && !refreshRequested && stableFrames > kIdleSettleFrames && vts.inFlight.empty();
+        if (idle) {
+            glfwWaitEventsTimeout(kIdleWaitSeconds);
+            int w, h; glfwGetFramebufferSize(win, &w, &h);
+            winW = w; winH = h;
+            last = (float)glfwGetTime();            // no dt spike for held keys when it wakes
+            pacer.last = 0.0;                       // nor a pacing interval across the wait
+            continue;
+        }
+        refreshRequested = false;
 
-        glViewport(0, 0, winW, winH);
+        vtUpdate(vts);
+        residencyUpdate(residency, pool);
+
+        // the scene target follows the render scale; the HUD and the capture stay at window size
+        const int sceneW = scaledSize(winW, renderScale.scale), sceneH = scaledSize(winH, renderScale.scale);
+        hdrPostResize(post, sceneW, sceneH);
+        glBindFramebuffer(GL_FRAMEBUFFER, post.fbo);
+        glViewport(0, 0, sceneW, sceneH);
+        postTimerBegin(post, frameIndex, POST_SCENE);
         glClearColor(0.02f, 0.02f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // starfield sky (inside-out)
-        if (showStars) {
-            glDepthMask(GL_FALSE);
-            glCullFace(GL_FRONT);
-            glm::mat4 M = glm::translate(glm::mat4(1), eye);
-            glUseProgram(prog);
-            glUniformMatrix4fv(uView, 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
-            glUniformMatrix4fv(uProj, 1, GL_FALSE, glm::value_ptr(proj));
-            glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(M));
-            glUniform3fv(uLightPos, 1, glm::value_ptr(glm::vec3(0)));
-            glUniform3fv(uLightColor, 1, glm::value_ptr(glm::vec3(1)));
-            glUniform3fv(uViewPos, 1, glm::value_ptr(eye));
-            glUniform1i(uUseTex, GL_TRUE);
-            glUniform3f(uBase, 1, 1, 1);
-            glUniform3f(uEmis, 1, 1, 1);
-            glUniform1f(uSh, 32.0f);
-            glUniform1f(uKs, 0.0f);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texStars);
-            glBindVertexArray(skyMesh.VAO);
-            glDrawElements(GL_TRIANGLES, skyMesh.indexCount, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-            glCullFace(GL_BACK);
-            glDepthMask(GL_TRUE);
-        }
+        // the scene's other lights are in pointLights already; add the benchmark's belt beacons and bin them
+        static const glm::vec3 kBeaconColors[] = { { 2.0f, 1.0f, 0.4f }, { 0.6f, 1.2f, 2.0f }, { 2.0f, 1.8f, 1.2f }, { 1.2f, 2.0f, 1.0f } };
+        for (int k = 0; k < beltLights; ++k)
+            pointLights.push_back({ beltRockPos(belt[(size_t)k * belt.size() / beltLights]), 2.5f, kBeaconColors[k % 4] });
+        buildLightClusters(clusters, pointLights, view, proj, nearZ, farZ, sceneW, sceneH);
+        lightClustersBind(clusters);
+        const uint32_t clusteredBit = clusters.references ? (uint32_t)LIT_CLUSTERED_LIGHTS : 0u;
+
+        // lit variants pick these up on their first draw of the frame
+        const LitFrame litFrame{ view, proj, primaryPos, primaryColor, eye, lightRadius, clusters.params, frameIndex };
+
+        // only the uniforms the variant was compiled with
+        auto setMaterial = [&](const LitProgram& lp, uint32_t bits, const Material& m) {
+            if (!(bits & (LIT_TEXTURED | LIT_VIRTUAL_TEXTURE))) glUniform3fv(lp.baseColor, 1, glm::value_ptr(m.base));
+            if (bits & LIT_EMISSIVE) glUniform3fv(lp.emissive, 1, glm::value_ptr(m.emissive));
+            if (!(bits & LIT_UNLIT)) { glUniform1f(lp.shininess, m.shininess); glUniform1f(lp.ks, m.ks); }
+            };
+        auto emissiveBit = [](const Material& m) { return m.emissive != glm::vec3(0.0f) ? (uint32_t)LIT_EMISSIVE : 0u; };
 
-        // main shader
-        glUseProgram(prog);
-        glUniformMatrix4fv(uView, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(uProj, 1, GL_FALSE, glm::value_ptr(proj));
-        glUniform3fv(uLightPos, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-        glUniform3fv(uLightColor, 1, glm::value_ptr(glm::vec3(7, 7, 7)));
-        glUniform3fv(uViewPos, 1, glm::value_ptr(eye));
+        // screen coverage for the residency manager, consumed by next frame's residencyUpdate
+        auto cover = [&](GLuint t, const glm::mat4& M, float radius) {
+            residencyCover(residency, t, projectedRadiusPx(glm::vec3(M[3]), radius, eye, fovDeg, sceneH));
+            };
 
-        auto setMaterial = [&](float sh, float ks) {
-            glUniform1f(uSh, sh);
-            glUniform1f(uKs, ks);
+        auto setOccluders = [&](const LitProgram& lp, size_t receiver) {
+            int n = eclipses.count[receiver];
+            glUniform1i(lp.occluderCount, n);
+            glUniform4fv(lp.occluders, n, glm::value_ptr(eclipses.occ[receiver * kMaxOccluders]));
             };
 
-        // Sun (emissive)
-        glm::mat4 Msun = glm::rotate(glm::mat4(1), glm::radians(sun.spinAngle), glm::vec3(0, 1, 0));
-        glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(Msun));
-        glUniform1i(uUseTex, GL_TRUE);
-        glUniform3f(uBase, 1.0f, 0.8f, 0.2f);
-        glUniform3f(uEmis, 2.2f, 2.2f, 2.2f);
-        setMaterial(16.0f, 0.0f);
-        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, texSun);
-        glBindVertexArray(sun.mesh.VAO);
-        glDrawElements(GL_TRIANGLES, sun.mesh.indexCount, GL_UNSIGNED_INT, 0);
-
-        auto drawPlanet = [&](Planet& p, float shin, float ks, bool useTex = true) {
-            glm::mat4 T = glm::rotate(glm::mat4(1), glm::radians(p.orbitAngle), glm::vec3(0, 1, 0));
-            T = glm::translate(T, glm::vec3(p.orbitRadius, 0, 0));
-            T = glm::rotate(T, glm::radians(p.spinAngle), glm::vec3(0, 1, 0));
-            glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(T));
-            glUniform1i(uUseTex, useTex ? GL_TRUE : GL_FALSE);
-            glUniform3f(uBase, 1, 1, 1);
-            glUniform3f(uEmis, 0, 0, 0);
-            setMaterial(shin, ks);
+        for (size_t i = 0; i < bodies.size(); ++i) opaqueOrder[i] = i;
+        if (opaqueMode != OPAQUE_SCENE_ORDER) sortFrontToBack(opaqueOrder, bodyWorld, shadowRadius, view);
+        if (opaqueMode == OPAQUE_DEPTH_PREPASS) {
+            glUseProgram(depthProg);
+            glUniformMatrix4fv(glGetUniformLocation(depthProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(depthProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+            GLint uDepthModel = glGetUniformLocation(depthProg, "model");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            for (size_t i : opaqueOrder) {
+                glUniformMatrix4fv(uDepthModel, 1, GL_FALSE, glm::value_ptr(meshModel(bodyWorld[i], bodies[i].mesh)));
+                drawMesh(bodies[i].mesh);
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            // depth is final: the lit pass only shades the surviving fragment at each pixel
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        // opaque bodies, the belt, then the sky behind them; the rings blend over all of it
+        glActiveTexture(GL_TEXTURE0);
+        fragmentCounterBegin(shadedFragments, frameIndex, opaqueMode);
+        for (size_t i : opaqueOrder) {
+            const Planet& p = bodies[i];
+            const glm::mat4& M = bodyWorld[i];
+            cover(p.tex, M, p.mesh.scale);
+            uint32_t bits = (p.vt >= 0 ? LIT_VIRTUAL_TEXTURE : p.tex ? LIT_TEXTURED : 0u) | emissiveBit(p.mat)
+                          | ((int)i == lightBody ? (uint32_t)LIT_UNLIT : (eclipses.count[i] ? LIT_ECLIPSE : 0u) | clusteredBit);
+            LitProgram& lp = useLit(litVariants, bits, litFrame);
+            glUniformMatrix4fv(lp.model, 1, GL_FALSE, glm::value_ptr(meshModel(M, p.mesh)));
+            setMaterial(lp, bits, p.mat);
+            if (bits & LIT_ECLIPSE) setOccluders(lp, i);
+            if (p.vt >= 0) {
+                vtSetUniforms(lp.vt, vts.vts[p.vt], 0.0f);
+                glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, vts.poolTex);
+                glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, vts.vts[p.vt].tableTex);
+                glActiveTexture(GL_TEXTURE0);
+                drawMesh(p.mesh);
+                continue;
+            }
             glBindTexture(GL_TEXTURE_2D, p.tex);
-            glBindVertexArray(p.mesh.VAO);
-            glDrawElements(GL_TRIANGLES, p.mesh.indexCount, GL_UNSIGNED_INT, 0);
-            };
+            drawMesh(p.mesh);
+        }
+        fragmentCounterEnd();
+        if (opaqueMode == OPAQUE_DEPTH_PREPASS) { glDepthMask(GL_TRUE); glDepthFunc(GL_LESS); }
+
+        // asteroid belt (benchmark stress scene)
+        if (!belt.empty()) {
+            GLuint rockTex = beltTex >= 0 ? tex[beltTex] : 0;
+            const Material rock{ rockTex ? glm::vec3(1.0f) : glm::vec3(0.55f, 0.52f, 0.48f), glm::vec3(0.0f), 8.0f, 0.05f };
+            uint32_t bits = (rockTex ? LIT_TEXTURED : 0u) | clusteredBit;
+            LitProgram& lp = useLit(litVariants, bits, litFrame);
+            setMaterial(lp, bits, rock);
+            glBindTexture(GL_TEXTURE_2D, rockTex);
+            for (const BeltRock& r : belt) {
+                glm::mat4 M = glm::rotate(glm::mat4(1), glm::radians(r.angle), glm::vec3(0, 1, 0));
+                M = glm::scale(glm::translate(M, glm::vec3(r.radius, r.height, 0)), glm::vec3(r.size));
+                glUniformMatrix4fv(lp.model, 1, GL_FALSE, glm::value_ptr(M));
+                drawMesh(lod48);
+            }
+        }
+
+        // starfield: only the pixels nothing opaque covered pass the depth test
+        glm::mat4 skyView = glm::mat4(glm::mat3(view));       // rotation only: the sky is at infinity
+        bool drawCatalog = starMode == STARS_CATALOG && starField.count;
+        starsDrawn = 0;
+        if (drawCatalog) {
+            // zooming in reveals fainter stars, as a telescope's narrower field would
+            float limitMag = kStarLimitMag + 5.0f * std::log10(45.0f / fovDeg);
+            starsDrawn = starsBrighterThan(starField, limitMag);
+            glUseProgram(starProg);
+            glUniformMatrix4fv(glGetUniformLocation(starProg, "viewProj"), 1, GL_FALSE, glm::value_ptr(proj * skyView));
+            glUniform1f(glGetUniformLocation(starProg, "magMin"), kStarMagMin);
+            glUniform1f(glGetUniformLocation(starProg, "limitMag"), limitMag);
+            glUniform1f(glGetUniformLocation(starProg, "pointScale"), std::max(1.0f, sceneH / 1080.0f));
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            glBindVertexArray(starField.vao);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)starsDrawn);
+            glBindVertexArray(0);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        }
+        else if (starMode != STARS_OFF && skyCube) {
+            glUseProgram(skyProg);
+            glUniformMatrix4fv(glGetUniformLocation(skyProg, "invViewProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(proj * skyView)));
+            glUniform1i(glGetUniformLocation(skyProg, "sky"), 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, skyCube);
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+            glBindVertexArray(skyVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        }
 
-        // Planets
-        drawPlanet(mercury, 64.0f, 0.35f);
-        drawPlanet(venus, 64.0f, 0.35f);
-        drawPlanet(earth, 64.0f, 0.40f);
-
-        // Moon around Earth
-        glm::mat4 Me = glm::rotate(glm::mat4(1), glm::radians(earth.orbitAngle), glm::vec3(0, 1, 0));
-        Me = glm::translate(Me, glm::vec3(earth.orbitRadius, 0, 0));
-        glm::mat4 Mm = glm::rotate(Me, glm::radians(moon.orbitAngle), glm::vec3(0, 1, 0));
-        Mm = glm::translate(Mm, glm::vec3(moon.orbitRadius, 0, 0));
-        Mm = glm::rotate(Mm, glm::radians(moon.spinAngle), glm::vec3(0, 1, 0));
-        glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(Mm));
-        glUniform1i(uUseTex, GL_TRUE);
-        glUniform3f(uBase, 1, 1, 1);
-        glUniform3f(uEmis, 0, 0, 0);
-        setMaterial(16.0f, 0.20f);
-        glBindTexture(GL_TEXTURE_2D, texMoon);
-        glBindVertexArray(moon.mesh.VAO);
-        glDrawElements(GL_TRIANGLES, moon.mesh.indexCount, GL_UNSIGNED_INT, 0);
-
-        drawPlanet(mars, 64.0f, 0.35f);
-        drawPlanet(jupiter, 32.0f, 0.25f);
-
-        // Europa around Jupiter
-        glm::mat4 Mj = glm::rotate(glm::mat4(1), glm::radians(jupiter.orbitAngle), glm::vec3(0, 1, 0));
-        Mj = glm::translate(Mj, glm::vec3(jupiter.orbitRadius, 0, 0));
-        glm::mat4 Meur = glm::rotate(Mj, glm::radians(europa.orbitAngle), glm::vec3(0, 1, 0));
-        Meur = glm::translate(Meur, glm::vec3(europa.orbitRadius, 0, 0));
-        Meur = glm::rotate(Meur, glm::radians(europa.spinAngle), glm::vec3(0, 1, 0));
-        glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(Meur));
-        glUniform1i(uUseTex, GL_TRUE);
-        glUniform3f(uBase, 1, 1, 1);
-        glUniform3f(uEmis, 0, 0, 0);
-        setMaterial(16.0f, 0.20f);
-        glBindTexture(GL_TEXTURE_2D, texMoon);
-        glBindVertexArray(europa.mesh.VAO);
-        glDrawElements(GL_TRIANGLES, europa.mesh.indexCount, GL_UNSIGNED_INT, 0);
-
-        drawPlanet(saturn, 32.0f, 0.25f);
-
-        // Saturn ring
-        glm::mat4 Ms = glm::rotate(glm::mat4(1), glm::radians(saturn.orbitAngle), glm::vec3(0, 1, 0));
-        Ms = glm::translate(Ms, glm::vec3(saturn.orbitRadius, 0, 0));
-        Ms = glm::rotate(Ms, glm::radians(27.0f), glm::vec3(1, 0, 0));
-        glUniformMatrix4fv(uModel, 1, GL_FALSE, glm::value_ptr(Ms));
-        glUniform1i(uUseTex, GL_TRUE);
-        glUniform3f(uBase, 1, 1, 1);
-        glUniform3f(uEmis, 0, 0, 0);
-        setMaterial(8.0f, 0.05f);
-        glBindTexture(GL_TEXTURE_2D, texRing);
-        glBindVertexArray(ringMesh.VAO);
-        glDrawElements(GL_TRIANGLES, ringMesh.indexCount, GL_UNSIGNED_INT, 0);
-
-        drawPlanet(uranus, 32.0f, 0.25f);
-        drawPlanet(neptune, 32.0f, 0.25f);
+        // rings
+        for (size_t i = 0; i < rings.size(); ++i) {
+            const Ring& r = rings[i];
+            size_t receiver = bodies.size() + i;
+            uint32_t bits = LIT_RING_ALPHA | (r.tex ? LIT_TEXTURED : 0u) | emissiveBit(r.mat)
+                          | (eclipses.count[receiver] ? LIT_ECLIPSE : 0u) | clusteredBit;
+            LitProgram& lp = useLit(litVariants, bits, litFrame);
+            glm::mat4 M = glm::rotate(bodyFrame[r.parent], glm::radians(r.tilt), glm::vec3(1, 0, 0));
+            glUniformMatrix4fv(lp.model, 1, GL_FALSE, glm::value_ptr(M));
+            setMaterial(lp, bits, r.mat);
+            if (bits & LIT_ECLIPSE) setOccluders(lp, receiver);
+            glBindTexture(GL_TEXTURE_2D, r.tex);
+            drawMesh(r.mesh);
+            cover(r.tex, M, r.outer);
+        }
 
         // orbit lines
         if (showOrbits) {
@@ -651,13 +3945,39 @@ int main() {
             for (const Mesh& L : orbitLines) {
                 glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(VP));
                 glUniform3fv(uCol, 1, glm::value_ptr(col));
-                glBindVertexArray(L.VAO);
-                glDrawElements(GL_LINES, L.indexCount, GL_UNSIGNED_INT, 0);
+                drawMesh(L, GL_LINES);
             }
         }
 
-        // ===== HUD: 2D Circle (top-left) =====
+        postTimerEnd();
+
+        // VT feedback: low-res pass over the virtual-textured bodies, read back a frame later
+        if (!vts.vts.empty()) {
+            vtResizeFeedback(vts, sceneW, sceneH);
+            glBindFramebuffer(GL_FRAMEBUFFER, vts.fbo);
+            glViewport(0, 0, vts.fbW, vts.fbH);
+            const GLuint none[4] = { 0, 0, 0, 0 };
+            glClearBufferuiv(GL_COLOR, 0, none);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            glUseProgram(fbProg);
+            glUniformMatrix4fv(uFbView, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(uFbProj, 1, GL_FALSE, glm::value_ptr(proj));
+            for (size_t i = 0; i < bodies.size(); ++i) {
+                const Planet& p = bodies[i];
+                if (p.vt < 0) continue;
+                glUniformMatrix4fv(uFbModel, 1, GL_FALSE, glm::value_ptr(meshModel(bodyWorld[i], p.mesh)));
+                glUniform1ui(uFbId, (GLuint)p.vt + 1);
+                vtSetUniforms(fbVtU, vts.vts[p.vt], -log2f((float)kVtFeedbackDiv));
+                drawMesh(p.mesh);
+            }
+            vtReadFeedback(vts, pool, frameIndex);
+        }
+
+        hdrPostResolve(post, mainFbo, winW, winH, bloomOn, frameIndex);
+
+        // ===== HUD: 2D Circle (top-left), over the tonemapped image =====
         {
+            glDisable(GL_DEPTH_TEST);
             glUseProgram(lineProg);
             GLint uMVP = glGetUniformLocation(lineProg, "mvp");
             GLint uCol = glGetUniformLocation(lineProg, "color");
@@ -669,18 +3989,60 @@ int main() {
             glm::mat4 MVP2D = Ortho * M2D;
             glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(MVP2D));
             glUniform3f(uCol, 0.9f, 0.9f, 0.9f);
-            glBindVertexArray(hudCircle.VAO);
-            glDrawElements(GL_LINES, hudCircle.indexCount, GL_UNSIGNED_INT, 0);
+            drawMesh(hudCircle, GL_LINES);
+            glEnable(GL_DEPTH_TEST);
         }
 
+        if (captureToggle) {
+            captureToggle = false;
+            if (capture.active) captureStop(capture); else captureStart(capture, winW, winH);
+        }
+        if (capture.active && !benchMode) captureFrame(capture, winW, winH);
+
+        double cpuMs = (glfwGetTime() - frameStart) * 1000.0;
         glfwSwapBuffers(win);
+        // pace before polling so the next frame starts from the freshest input; benchmarks run flat out
+        if (!benchMode && swapInterval != appliedSwapInterval) glfwSwapInterval(appliedSwapInterval = swapInterval);
+        double cap = fpsCap;
+        if (paused && pausedFps > 0.0) cap = cap > 0.0 ? std::min(cap, pausedFps) : pausedFps;
+        framePace(pacer, benchMode ? 0.0 : cap);
         glfwPollEvents();
+        inputEndFrame(win, stateHash);
+        ++frameIndex;
+
+        if (firstFrame) {
+            firstFrame = false;
+            std::printf("Time to first frame: %.1f ms\n", startupMs());
+            printStartupTimeline();
+        }
 
         int w, h; glfwGetFramebufferSize(win, &w, &h);
         winW = w; winH = h;
+        renderScaleUpdate(renderScale, cpuMs, post.ms[POST_SCENE] + post.ms[POST_BLOOM_DOWN] + post.ms[POST_BLOOM_UP] + post.ms[POST_TONEMAP]);
+
+        if (benchMode) {
+            // glFinish so a frame's time covers its GPU work; warmup frames are not recorded
+            glFinish();
+            double t = glfwGetTime();
+            if (benchFrame++ >= kBenchWarmupFrames) benchResults.back().frameMs.push_back((t - benchLast) * 1000.0);
+            else if (benchFrame == kBenchWarmupFrames) benchTime = 0.0f;
+            benchLast = t;
+            if (benchTime >= scenarios[benchIndex].duration) {
+                if (++benchIndex == scenarios.size()) break;
+                startScenario(scenarios[benchIndex]);
+            }
+        }
+    }
+
+    if (benchMode) {
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        if (writeBenchJson(benchOut, benchResults, renderer ? renderer : "unknown")) std::cout << "\nBenchmark results written to " << benchOut;
+        else std::cerr << "\nCannot write " << benchOut;
     }
 
     std::cout << "\n"; // finish the last inline FPS line with a newline
+    inputFinish();
+    captureStop(capture);
     glfwTerminate();
     return 0;
 }
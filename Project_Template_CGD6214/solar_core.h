@@ -0,0 +1,433 @@
+﻿// ===== Solar System — CPU kernels =====
+// Everything here is GL-free so it can be shared by the app (main.cpp) and the
+// micro-benchmarks (bench.cpp): vertex formats, mesh generation and optimisation,
+// image decode, the orbit integrator and per-body transforms, and the Chebyshev ephemeris.
+#pragma once
+
+#include "stb_image.h"   // declarations only; main.cpp / bench.cpp define STB_IMAGE_IMPLEMENTATION
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ===================== VERTEX FORMATS =====================
+struct Vtx { glm::vec3 p; glm::vec3 n; glm::vec2 uv; };
+// compact unit-sphere vertex (12 bytes vs 32): snorm16 position that is also the normal, unorm16 UV
+struct VtxS { int16_t p[4]; uint16_t uv[2]; };
+static_assert(sizeof(VtxS) == 12, "VtxS must stay tightly packed");
+
+inline int16_t snorm16(float x) { return (int16_t)std::lround(glm::clamp(x, -1.0f, 1.0f) * 32767.0f); }
+inline uint16_t unorm16(float x) { return (uint16_t)std::lround(glm::clamp(x, 0.0f, 1.0f) * 65535.0f); }
+
+// ===================== MESH OPTIMIZATION =====================
+// Forsyth "linear-speed vertex cache optimisation" followed by a first-use vertex
+// reorder for fetch locality. Runs on every generated triangle mesh.
+static const int kForsythCache = 32;
+inline float forsythScore(int cachePos, int remaining) {
+    if (remaining == 0) return -1.0f;
+    float s = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) s = 0.75f;               // the triangle just emitted
+        else s = powf(1.0f - float(cachePos - 3) / (kForsythCache - 3), 1.5f);
+    }
+    return s + 2.0f * powf((float)remaining, -0.5f); // valence boost: finish off lonely vertices
+}
+
+inline void optimizeVertexCache(std::vector<unsigned int>& idx, size_t vertexCount) {
+    const size_t triCount = idx.size() / 3;
+    if (triCount == 0) return;
+    std::vector<int> remaining(vertexCount, 0), offset(vertexCount + 1, 0), cachePos(vertexCount, -1);
+    for (unsigned int i : idx) ++remaining[i];
+    for (size_t v = 0; v < vertexCount; ++v) offset[v + 1] = offset[v] + remaining[v];
+    std::vector<int> triList(idx.size()), fill(offset.begin(), offset.end() - 1);
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k) triList[fill[idx[t * 3 + k]]++] = (int)t;
+
+    std::vector<float> vScore(vertexCount), tScore(triCount);
+    for (size_t v = 0; v < vertexCount; ++v) vScore[v] = forsythScore(-1, remaining[v]);
+    int best = 0;
+    for (size_t t = 0; t < triCount; ++t) {
+        tScore[t] = vScore[idx[t * 3]] + vScore[idx[t * 3 + 1]] + vScore[idx[t * 3 + 2]];
+        if (tScore[t] > tScore[best]) best = (int)t;
+    }
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<unsigned int> out; out.reserve(idx.size());
+    int cache[kForsythCache + 3], cacheCount = 0;
+    size_t scan = 0;
+    while (out.size() < idx.size()) {
+        if (best < 0) {                            // nothing useful in cache: take the next unused triangle
+            while (emitted[scan]) ++scan;
+            best = (int)scan;
+        }
+        emitted[best] = 1;
+        int next[kForsythCache + 3], n = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = idx[best * 3 + k];
+            out.push_back(v);
+            int* list = &triList[offset[v]];       // drop the triangle from the vertex's active list
+            for (int i = 0; i < remaining[v]; ++i)
+                if (list[i] == best) { list[i] = list[remaining[v] - 1]; break; }
+            --remaining[v];
+            next[n++] = (int)v;
+        }
+        for (int i = 0; i < cacheCount; ++i)
+            if (cache[i] != next[0] && cache[i] != next[1] && cache[i] != next[2]) next[n++] = cache[i];
+        for (int i = 0; i < n; ++i) {
+            cachePos[next[i]] = i < kForsythCache ? i : -1;
+            vScore[next[i]] = forsythScore(cachePos[next[i]], remaining[next[i]]);
+        }
+        best = -1; float bestScore = -1.0f;
+        for (int i = 0; i < n; ++i) {
+            int v = next[i];
+            for (int j = 0; j < remaining[v]; ++j) {
+                int t = triList[offset[v] + j];
+                tScore[t] = vScore[idx[t * 3]] + vScore[idx[t * 3 + 1]] + vScore[idx[t * 3 + 2]];
+                if (tScore[t] > bestScore) { bestScore = tScore[t]; best = t; }
+            }
+        }
+        cacheCount = std::min(n, kForsythCache);
+        std::copy(next, next + cacheCount, cache);
+    }
+    idx.swap(out);
+}
+
+// renumber vertices in first-use order so the fetch stream walks memory forwards
+template <class V>
+inline void optimizeVertexFetch(std::vector<V>& v, std::vector<unsigned int>& idx) {
+    std::vector<unsigned int> remap(v.size(), ~0u);
+    std::vector<V> out; out.reserve(v.size());
+    for (unsigned int& i : idx) {
+        if (remap[i] == ~0u) { remap[i] = (unsigned int)out.size(); out.push_back(v[i]); }
+        i = remap[i];
+    }
+    v.swap(out);
+}
+
+// ACMR = post-transform cache misses per triangle, ATVR = misses per vertex (1.0 is ideal)
+struct CacheStats { float acmr = 0, atvr = 0; };
+inline CacheStats simulateFifoCache(const std::vector<unsigned int>& idx, size_t vertexCount, int cacheSize = 16) {
+    std::vector<int> stamp(vertexCount, -cacheSize - 1);
+    int misses = 0;
+    for (unsigned int i : idx)
+        if (misses - stamp[i] > cacheSize) stamp[i] = misses++;   // FIFO: only a miss pushes an entry
+    CacheStats s;
+    if (!idx.empty()) s.acmr = misses / (idx.size() / 3.0f);
+    if (vertexCount) s.atvr = misses / (float)vertexCount;
+    return s;
+}
+
+// the app prints one line per generated mesh; the benchmarks switch it off
+inline bool& meshStatsOutput() { static bool on = true; return on; }
+template <class V>
+inline void optimizeMesh(std::vector<V>& v, std::vector<unsigned int>& idx, const char* label) {
+    CacheStats before = simulateFifoCache(idx, v.size());
+    optimizeVertexCache(idx, v.size());
+    optimizeVertexFetch(v, idx);
+    CacheStats after = simulateFifoCache(idx, v.size());
+    if (meshStatsOutput()) std::printf("Mesh %-16s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", label, before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+// ===================== COMPILE-TIME TABLES =====================
+// constexpr sin/cos (range-reduced Taylor series in double) so the segment counts the scene
+// uses get their unit-circle samples baked into the binary instead of computed at launch.
+constexpr double kCtPi = 3.14159265358979323846;
+constexpr double ctSin(double x) {
+    while (x > kCtPi) x -= 2.0 * kCtPi;
+    while (x < -kCtPi) x += 2.0 * kCtPi;
+    if (x > 0.5 * kCtPi) x = kCtPi - x;         // fold into [-pi/2, pi/2] where the series converges fast
+    if (x < -0.5 * kCtPi) x = -kCtPi - x;
+    double term = x, sum = x;
+    for (int k = 1; k < 12; ++k) { term *= -x * x / ((2.0 * k) * (2.0 * k + 1.0)); sum += term; }
+    return sum;
+}
+constexpr double ctCos(double x) { return ctSin(x + 0.5 * kCtPi); }
+
+// cos/sin of k * 2pi / N for k = 0..N; the closing sample repeats the first like the generators expect
+template <int N>
+struct UnitCircle {
+    float c[N + 1], s[N + 1];
+    constexpr UnitCircle() : c(), s() {
+        for (int k = 0; k <= N; ++k) {
+            c[k] = (float)ctCos(2.0 * kCtPi * k / N);
+            s[k] = (float)ctSin(2.0 * kCtPi * k / N);
+        }
+    }
+};
+struct CircleView { const float* c; const float* s; };
+template <int N>
+inline CircleView circleTable() {
+    static constexpr UnitCircle<N> t{};
+    return { t.c, t.s };
+}
+
+// a sphere with S stacks walks half of the 2S circle, so these cover every lattice main.cpp builds
+inline CircleView circleSamples(int n, std::vector<float>& scratch) {
+    switch (n) {
+    case 48:  return circleTable<48>();
+    case 56:  return circleTable<56>();
+    case 64:  return circleTable<64>();
+    case 80:  return circleTable<80>();
+    case 88:  return circleTable<88>();
+    case 96:  return circleTable<96>();
+    case 128: return circleTable<128>();
+    case 256: return circleTable<256>();
+    }
+    scratch.resize(2 * (n + 1));
+    for (int k = 0; k <= n; ++k) {
+        float th = (float)k / n * glm::two_pi<float>();
+        scratch[k] = cosf(th); scratch[n + 1 + k] = sinf(th);
+    }
+    return { scratch.data(), scratch.data() + n + 1 };
+}
+
+// ---- generators ----
+inline void genSphere(int stacks, int slices, std::vector<VtxS>& v, std::vector<unsigned int>& idx) {
+    std::vector<float> scratchU, scratchV;
+    CircleView ring = circleSamples(slices, scratchU), arc = circleSamples(2 * stacks, scratchV);
+    v.resize((size_t)(stacks + 1) * (slices + 1));
+    idx.resize((size_t)stacks * slices * 6);
+    VtxS* out = v.data();
+    for (int i = 0; i <= stacks; ++i) {
+        float fv = (float)i / stacks, y = arc.c[i], rr = arc.s[i];
+        for (int j = 0; j <= slices; ++j) {
+            float fu = (float)j / slices, x = rr * ring.c[j], z = rr * ring.s[j];
+            *out++ = { { snorm16(x), snorm16(y), snorm16(z), 0 }, { unorm16(fu), unorm16(1.0f - fv) } };
+        }
+    }
+    unsigned int* o = idx.data();
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            int r1 = i * (slices + 1), r2 = (i + 1) * (slices + 1);
+            *o++ = r1 + j; *o++ = r2 + j; *o++ = r2 + j + 1;
+            *o++ = r1 + j; *o++ = r2 + j + 1; *o++ = r1 + j + 1;
+        }
+    }
+    char label[32]; std::snprintf(label, sizeof(label), "sphere %dx%d", stacks, slices);
+    optimizeMesh(v, idx, label);
+}
+
+inline void genRing(int segments, float innerR, float outerR, std::vector<Vtx>& v, std::vector<unsigned int>& idx) {
+    std::vector<float> scratch;
+    CircleView cs = circleSamples(segments, scratch);
+    v.resize((size_t)(segments + 1) * 2);
+    idx.resize((size_t)segments * 6);
+    for (int i = 0; i <= segments; ++i) {
+        float u = (float)i / segments, c = cs.c[i], s = cs.s[i];
+        v[i * 2] = { glm::vec3(outerR * c,0,outerR * s),glm::vec3(0,1,0),glm::vec2(u,1) };
+        v[i * 2 + 1] = { glm::vec3(innerR * c,0,innerR * s),glm::vec3(0,1,0),glm::vec2(u,0) };
+        if (i < segments) {
+            unsigned int b = i * 2, * o = &idx[i * 6];
+            o[0] = b; o[1] = b + 1; o[2] = b + 2;
+            o[3] = b + 1; o[4] = b + 3; o[5] = b + 2;
+        }
+    }
+    char label[32]; std::snprintf(label, sizeof(label), "ring %d", segments);
+    optimizeMesh(v, idx, label);
+}
+
+// a = semi-major axis, e = eccentricity; the parent sits at the focus, periapsis on +x
+inline void genOrbitLine(int segments, float a, std::vector<glm::vec3>& p, std::vector<unsigned int>& idx, float e = 0.0f) {
+    std::vector<float> scratch;
+    CircleView cs = circleSamples(segments, scratch);
+    p.resize(segments); idx.resize((size_t)segments * 2);
+    for (int i = 0; i < segments; ++i) {
+        float r = a * (1.0f - e * e) / (1.0f + e * cs.c[i]);
+        p[i] = glm::vec3(r * cs.c[i], 0, r * cs.s[i]);
+        idx[i * 2] = i; idx[i * 2 + 1] = (i + 1) % segments;
+    }
+}
+
+// ===================== IMAGE DECODE =====================
+// decode runs on any thread; the upload needs the GL context
+struct ImageData { std::string path; int w = 0, h = 0, ch = 0; unsigned char* pixels = nullptr; };
+inline ImageData decodeImageFile(const char* path, bool flipY = true) {
+    ImageData img; img.path = path;
+    stbi_set_flip_vertically_on_load_thread(flipY);
+    img.pixels = stbi_load(path, &img.w, &img.h, &img.ch, 0);
+    return img;
+}
+
+// ===================== CAMERA =====================
+inline glm::vec3 orbitCamPos(float yaw, float pitch, float dist) {
+    float cp = cosf(pitch), sp = sinf(pitch), sy = sinf(yaw), cy = cosf(yaw);
+    return { dist * cp * sy, dist * sp, dist * cp * cy };
+}
+
+// ===================== ORBIT INTEGRATION =====================
+// Orbits are Keplerian ellipses with the parent at a focus: orbitAngle is the true anomaly and
+// orbitSpeed the mean motion n (deg/s). The angular rate peaks at periapsis, so a body's step
+// budget comes from that peak: fast, eccentric inner moons get many substeps, outer planets one.
+static const float kMaxSubstepDeg = 2.0f;          // no substep moves a body further along its orbit
+static const int kMaxSubstepLog2 = 10;             // budgets are powers of two, 1..1024 substeps
+
+inline float orbitDistance(float a, float e, float thetaDeg) {
+    return e == 0.0f ? a : a * (1.0f - e * e) / (1.0f + e * std::cos(glm::radians(thetaDeg)));
+}
+// dtheta/dt = c (1 + e cos theta)^2 with c = n / (1 - e^2)^1.5; this returns c
+inline float anomalyRateScale(float n, float e) { return n / std::pow(1.0f - e * e, 1.5f); }
+inline int substepBudgetLog2(float c, float e, float adv) {
+    float steps = std::fabs(c * (1.0f + e) * (1.0f + e) * adv) / kMaxSubstepDeg;
+    int l = 0;
+    while (l < kMaxSubstepLog2 && (float)(1 << l) < steps) ++l;
+    return l;
+}
+// RK4 over a contiguous SoA batch that shares one budget: steps outer, bodies inner so each pass
+// is a straight loop over the arrays. Angles are wrapped to keep float precision over long runs.
+inline void integrateAnomaly(float* theta, const float* c, const float* e, int count, int steps, float dt) {
+    const float rad = glm::pi<float>() / 180.0f;
+    for (int s = 0; s < steps; ++s)
+        for (int i = 0; i < count; ++i) {
+            float ci = c[i], ei = e[i], t = theta[i];
+            float q1 = 1.0f + ei * std::cos(t * rad), k1 = ci * q1 * q1;
+            float q2 = 1.0f + ei * std::cos((t + 0.5f * dt * k1) * rad), k2 = ci * q2 * q2;
+            float q3 = 1.0f + ei * std::cos((t + 0.5f * dt * k2) * rad), k3 = ci * q3 * q3;
+            float q4 = 1.0f + ei * std::cos((t + dt * k3) * rad), k4 = ci * q4 * q4;
+            theta[i] = std::fmod(t + dt / 6.0f * (k1 + 2.0f * k2 + 2.0f * k3 + k4), 360.0f);
+        }
+}
+
+// Body is anything with parent/ephem/orbitRadius/eccentricity/orbitSpeed/orbitAngle/spinAngle
+// (Planet in main.cpp). Parents precede children, so one forward pass resolves every body: frame
+// is the orbit position (what children and rings hang off), world adds the body's own spin.
+// ephemPos, when not empty, holds this frame's parent-relative positions for ephemeris bodies.
+template <class Body>
+inline void bodyTransforms(const std::vector<Body>& bodies, const std::vector<glm::vec3>& ephemPos,
+                           std::vector<glm::mat4>& frame, std::vector<glm::mat4>& world) {
+    frame.resize(bodies.size()); world.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const Body& b = bodies[i];
+        glm::mat4 P = b.parent >= 0 ? frame[b.parent] : glm::mat4(1);
+        if (b.ephem >= 0 && !ephemPos.empty()) frame[i] = glm::translate(P, ephemPos[i]);
+        else frame[i] = glm::translate(glm::rotate(P, glm::radians(b.orbitAngle), glm::vec3(0, 1, 0)),
+                                       glm::vec3(orbitDistance(b.orbitRadius, b.eccentricity, b.orbitAngle), 0, 0));
+        world[i] = glm::rotate(frame[i], glm::radians(b.spinAngle), glm::vec3(0, 1, 0));
+    }
+}
+
+// the orbit kernel: bodies are counting-sorted into SoA buckets by substep budget, each bucket is
+// integrated as one batch and the angles scattered back. Returns the largest budget used.
+template <class Body>
+inline int advanceOrbits(std::vector<Body>& bodies, float adv) {
+    static std::vector<int> budget, order;
+    static std::vector<float> rate, theta, c, e;
+    if (adv == 0.0f) return 0;
+    size_t n = bodies.size();
+    int start[kMaxSubstepLog2 + 2] = {};
+    budget.resize(n); rate.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Body& b = bodies[i];
+        rate[i] = anomalyRateScale(b.orbitSpeed, b.eccentricity);
+        budget[i] = b.orbitSpeed == 0.0f ? -1 : substepBudgetLog2(rate[i], b.eccentricity, adv);
+        if (budget[i] >= 0) ++start[budget[i] + 1];
+    }
+    for (int l = 0; l <= kMaxSubstepLog2; ++l) start[l + 1] += start[l];
+    int total = start[kMaxSubstepLog2 + 1], fill[kMaxSubstepLog2 + 1];
+    std::copy(start, start + kMaxSubstepLog2 + 1, fill);
+    order.resize(total); theta.resize(total); c.resize(total); e.resize(total);
+    for (size_t i = 0; i < n; ++i) {
+        if (budget[i] < 0) continue;
+        int k = fill[budget[i]]++;
+        order[k] = (int)i; theta[k] = bodies[i].orbitAngle; c[k] = rate[i]; e[k] = bodies[i].eccentricity;
+    }
+    int maxSteps = 0;
+    for (int l = 0; l <= kMaxSubstepLog2; ++l) {
+        int count = start[l + 1] - start[l], steps = 1 << l;
+        if (!count) continue;
+        integrateAnomaly(&theta[start[l]], &c[start[l]], &e[start[l]], count, steps, adv / steps);
+        maxSteps = steps;
+    }
+    for (int k = 0; k < total; ++k) bodies[order[k]].orbitAngle = theta[k];
+    return maxSteps;
+}
+
+// ===================== EPHEMERIS =====================
+// Mean Keplerian elements at J2000 and their rates per Julian century (Standish, "Approximate
+// Positions of the Planets", JPL; valid 1800-2050). Angles in degrees, a in AU.
+struct KeplerElements {
+    const char* name;
+    double a, e, I, L, wbar, node;
+    double da, de, dI, dL, dwbar, dnode;
+};
+static const KeplerElements kPlanetElements[] = {
+    { "mercury",  0.38709927, 0.20563593,  7.00497902, 252.25032350,  77.45779628,  48.33076593,
+                  0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081 },
+    { "venus",    0.72333566, 0.00677672,  3.39467605, 181.97909950, 131.60246718,  76.67984255,
+                  0.00000390,-0.00004107, -0.00078890, 58517.81538729, 0.00268329, -0.27769418 },
+    { "earth",    1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193,   0.0,
+                  0.00000562,-0.00004392, -0.01294668, 35999.37244981, 0.32327364,  0.0 },
+    { "mars",     1.52371034, 0.09339410,  1.84969142,  -4.55343205, -23.94362959,  49.55953891,
+                  0.00001847, 0.00007882, -0.00813131, 19140.30268499, 0.44441088, -0.29257343 },
+    { "jupiter",  5.20288700, 0.04838624,  1.30439695,  34.39644051,  14.72847983, 100.47390909,
+                 -0.00011607,-0.00013253, -0.00183714,  3034.74612775, 0.21252668,  0.20469106 },
+    { "saturn",   9.53667594, 0.05386179,  2.48599187,  49.95424423,  92.59887831, 113.66242448,
+                 -0.00125060,-0.00050991,  0.00193609,  1222.49362201,-0.41897216, -0.28867794 },
+    { "uranus",  19.18916464, 0.04725744,  0.77263783, 313.23810451, 170.95427630,  74.01692503,
+                 -0.00196176,-0.00004397, -0.00242939,   428.48202785, 0.40805281,  0.04240589 },
+    { "neptune", 30.06992276, 0.00859048,  1.77004347, -55.12002969,  44.96476227, 131.78422574,
+                  0.00026291, 0.00005105,  0.00035372,   218.45945325,-0.32241464, -0.01262724 },
+};
+static const int kPlanetCount = (int)(sizeof(kPlanetElements) / sizeof(kPlanetElements[0]));
+static const double kJ2000 = 2451545.0;
+
+// heliocentric ecliptic (J2000) position in AU at Julian date jd
+inline void keplerPosition(const KeplerElements& k, double jd, double out[3]) {
+    const double deg = glm::pi<double>() / 180.0;
+    double T = (jd - kJ2000) / 36525.0;
+    double a = k.a + k.da * T, e = k.e + k.de * T, I = (k.I + k.dI * T) * deg;
+    double L = k.L + k.dL * T, wbar = k.wbar + k.dwbar * T, node = k.node + k.dnode * T;
+    double w = (wbar - node) * deg, O = node * deg;
+    double M = std::remainder(L - wbar, 360.0) * deg;
+    double E = M + e * std::sin(M);
+    for (int i = 0; i < 8; ++i) {
+        double dE = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+        E -= dE;
+        if (std::fabs(dE) < 1e-14) break;
+    }
+    double xp = a * (std::cos(E) - e), yp = a * std::sqrt(1.0 - e * e) * std::sin(E);
+    double cw = std::cos(w), sw = std::sin(w), cO = std::cos(O), sO = std::sin(O), cI = std::cos(I), sI = std::sin(I);
+    out[0] = (cw * cO - sw * sO * cI) * xp + (-sw * cO - cw * sO * cI) * yp;
+    out[1] = (cw * sO + sw * cO * cI) * xp + (-sw * sO + cw * cO * cI) * yp;
+    out[2] = (sw * sI) * xp + (cw * sI) * yp;
+}
+
+// Chebyshev interpolation of f over one segment: n coefficients from samples at the n Chebyshev nodes
+static const int kChebMaxCoeffs = 32;
+template <class F>
+inline void chebFit(F f, double t0, double t1, int n, double* coeffs) {
+    double fx[kChebMaxCoeffs];
+    const double pi = glm::pi<double>();
+    for (int j = 0; j < n; ++j) fx[j] = f(0.5 * (t0 + t1) + 0.5 * (t1 - t0) * std::cos(pi * (j + 0.5) / n));
+    for (int k = 0; k < n; ++k) {
+        double sum = 0.0;
+        for (int j = 0; j < n; ++j) sum += fx[j] * std::cos(pi * k * (j + 0.5) / n);
+        coeffs[k] = (k == 0 ? 1.0 : 2.0) / n * sum;
+    }
+}
+
+// One segment of a multi-body ephemeris, laid out [component][coefficient][body] with bodies
+// innermost (padded to `stride`). Every body shares the segment's time span, so the basis T_k(tau)
+// is computed once and the accumulation over bodies is a unit-stride loop the compiler vectorizes.
+inline void chebEvalSegment(const double* block, int coeffs, int stride, double tau, double* x, double* y, double* z) {
+    double T[kChebMaxCoeffs];
+    T[0] = 1.0; T[1] = tau;
+    for (int k = 2; k < coeffs; ++k) T[k] = 2.0 * tau * T[k - 1] - T[k - 2];
+    double* out[3] = { x, y, z };
+    for (int c = 0; c < 3; ++c) {
+        double* o = out[c];
+        const double* b = block + (size_t)c * coeffs * stride;
+        for (int i = 0; i < stride; ++i) o[i] = b[i];
+        for (int k = 1; k < coeffs; ++k) {
+            const double t = T[k];
+            const double* bk = b + (size_t)k * stride;
+            for (int i = 0; i < stride; ++i) o[i] += t * bk[i];
+        }
+    }
+}